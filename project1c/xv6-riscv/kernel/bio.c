@@ -19,6 +19,7 @@
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "riscv.h"
+#include "trace.h"
 #include "defs.h"
 #include "fs.h"
 #include "buf.h"
@@ -95,6 +96,7 @@ bread(uint dev, uint blockno)
   struct buf *b;
 
   b = bget(dev, blockno);
+  TRACE(TR_BREAD, blockno, b->valid);
   if(!b->valid) {
     virtio_disk_rw(b, 0);
     b->valid = 1;
@@ -108,6 +110,7 @@ bwrite(struct buf *b)
 {
   if(!holdingsleep(&b->lock))
     panic("bwrite");
+  TRACE(TR_BWRITE, b->blockno, 0);
   virtio_disk_rw(b, 1);
 }
 
@@ -2,8 +2,11 @@ struct buf;
 struct context;
 struct file;
 struct inode;
+struct kmem_cache;
 struct pipe;
 struct proc;
+struct rbnode;
+struct rbtree;
 struct spinlock;
 struct sleeplock;
 struct stat;
@@ -59,11 +62,26 @@ void            ramdiskinit(void);
 void            ramdiskintr(void);
 void            ramdiskrw(struct buf*);
 
+// futex.c
+void            futexinit(void);
+
 // kalloc.c
 void*           kalloc(void);
 void            kfree(void *);
+void            kdup(void *);
+int             krefs(void *);
+int             kreserve(long);
+void            kunreserve(long);
+void*           kalloc_pages(int);
+void            kfree_pages(void *, int);
 void            kinit(void);
 
+// slab.c
+void            slabinit(void);
+struct kmem_cache* kmem_cache_create(char*, uint);
+void*           kmem_cache_alloc(struct kmem_cache*);
+void            kmem_cache_free(struct kmem_cache*, void*);
+
 // log.c
 void            initlog(int, struct superblock*);
 void            log_write(struct buf*);
@@ -71,6 +89,7 @@ void            begin_op(void);
 void            end_op(void);
 
 // pipe.c
+void            pipeinit(void);
 int             pipealloc(struct file**, struct file**);
 void            pipeclose(struct pipe*, int);
 int             piperead(struct pipe*, uint64, int);
@@ -85,10 +104,15 @@ void            printfinit(void);
 int             cpuid(void);
 void            exit(int);
 int             fork(void);
-int             growproc(int);
+int             growproc(int, uint64*);
+int             clone(uint64, uint64, uint64);
+int             join(int, uint64);
+int             vmshared(struct proc*);
+void            vmunshare(struct proc*);
+int             pagefault(pagetable_t, uint64, int);
 void            proc_mapstacks(pagetable_t);
 pagetable_t     proc_pagetable(struct proc *);
-void            proc_freepagetable(pagetable_t, uint64);
+void            proc_freepagetable(pagetable_t, uint64, uint64);
 int             kill(int);
 int             killed(struct proc*);
 void            setkilled(struct proc*);
@@ -98,10 +122,15 @@ struct proc*    myproc();
 void            procinit(void);
 void            scheduler(void) __attribute__((noreturn));
 void            sched(void);
+int             sched_tick(struct proc*);
+void            sched_clock(void);
 void            sleep(void*, struct spinlock*);
+void            sleep_exclusive(void*, struct spinlock*);
 void            userinit(void);
 int             wait(uint64);
 void            wakeup(void*);
+void            wakeup_one(void*);
+int             wakeup_n(void*, int);
 void            yield(void);
 int             either_copyout(int user_dst, uint64 dst, void *src, uint64 len);
 int             either_copyin(void *dst, int user_src, uint64 src, uint64 len);
@@ -118,13 +147,35 @@ void            release(struct spinlock*);
 void            push_off(void);
 void            pop_off(void);
 
+// lockstat.c
+extern volatile int lockstaton;
+int             lockstat_key(char*, int);
+void            lockstat_acquired(int, uint64, int);
+void            lockstat_released(int, uint64);
+
 // sleeplock.c
 void            acquiresleep(struct sleeplock*);
 void            releasesleep(struct sleeplock*);
 int             holdingsleep(struct sleeplock*);
 void            initsleeplock(struct sleeplock*, char*);
 
+// trace.c
+void            traceinit(void);
+void            trace(int, uint64, uint64);
+
+// prof.c
+void            profinit(void);
+void            profsample(struct proc*, int, uint64, uint64);
+
+// rbtree.c
+void            rb_insert(struct rbtree*, struct rbnode*, int (*)(struct rbnode*, struct rbnode*));
+void            rb_erase(struct rbtree*, struct rbnode*);
+struct rbnode*  rb_first(struct rbtree*);
+struct rbnode*  rb_last(struct rbtree*);
+struct rbnode*  rb_next(struct rbnode*);
+
 // string.c
+int             ffs(uint);
 int             memcmp(const void*, const void*, uint);
 void*           memmove(void*, const void*, uint);
 void*           memset(void*, int, uint);
@@ -147,6 +198,7 @@ void            trapinit(void);
 void            trapinithart(void);
 extern struct spinlock tickslock;
 void            usertrapret(void);
+void            ipi(int);
 
 // uart.c
 void            uartinit(void);
@@ -164,9 +216,12 @@ pagetable_t     uvmcreate(void);
 void            uvmfirst(pagetable_t, uchar *, uint);
 uint64          uvmalloc(pagetable_t, uint64, uint64, int);
 uint64          uvmdealloc(pagetable_t, uint64, uint64);
-int             uvmcopy(pagetable_t, pagetable_t, uint64);
+int             uvmcopy(pagetable_t, pagetable_t, uint64, int);
+int             uvmcow(pagetable_t, uint64);
+int             uvmfault(pagetable_t, uint64, uint64, int, int);
+int             uvmuncow(pagetable_t, uint64);
 void            uvmfree(pagetable_t, uint64);
-void            uvmunmap(pagetable_t, uint64, uint64, int);
+uint64          uvmunmap(pagetable_t, uint64, uint64, int);
 void            uvmclear(pagetable_t, uint64);
 pte_t *         walk(pagetable_t, uint64, int);
 uint64          walkaddr(pagetable_t, uint64);
@@ -3,6 +3,7 @@
 #include "memlayout.h"
 #include "riscv.h"
 #include "spinlock.h"
+#include "rbtree.h"
 #include "proc.h"
 #include "defs.h"
 #include "elf.h"
@@ -31,6 +32,10 @@ exec(char *path, char **argv)
   pagetable_t pagetable = 0, oldpagetable;
   struct proc *p = myproc();
 
+  // the other threads are still running in the old image.
+  if(vmshared(p))
+    return -1;
+
   begin_op();
 
   if((ip = namei(path)) == 0){
@@ -126,13 +131,16 @@ exec(char *path, char **argv)
   p->sz = sz;
   p->trapframe->epc = elf.entry;  // initial program counter = main
   p->trapframe->sp = sp; // initial stack pointer
-  proc_freepagetable(oldpagetable, oldsz);
+  vmunshare(p);          // no threads, and the new page table is ours alone
+  p->alarmInterval = 0;  // the old handler is gone with the old image
+  p->alarmActive = 0;
+  proc_freepagetable(oldpagetable, oldsz, p->tfva);
 
   return argc; // this ends up in a0, the first argument to main(argc, argv)
 
  bad:
   if(pagetable)
-    proc_freepagetable(pagetable, sz);
+    proc_freepagetable(pagetable, sz, p->tfva);
   if(ip){
     iunlockput(ip);
     end_op();
@@ -0,0 +1,101 @@
+// Futexes: sleeping on a user word.
+//
+// A waiter is keyed on the physical address of the word, so any
+// two mappings of the same memory (threads, for instance) meet on
+// the same key. Keys hash to a lock that makes futex_wait()'s check
+// of the word atomic with respect to futex_wake(), and the waiter
+// sleeps on the physical address as its channel. The pages of a
+// process with threads are never copy-on-write (see clone()), so
+// a word's physical address stays put while anyone waits on it.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rbtree.h"
+#include "proc.h"
+#include "defs.h"
+
+#define NFUTEXLOCK 64
+
+static struct spinlock futexlocks[NFUTEXLOCK];
+
+void
+futexinit(void)
+{
+  for(int i = 0; i < NFUTEXLOCK; i++)
+    initlock(&futexlocks[i], "futex");
+}
+
+// The physical address of the user word at va, or 0 if it isn't
+// a mapped, aligned user address.
+static uint64
+futex_key(uint64 va)
+{
+  uint64 pa;
+
+  if(va % sizeof(uint) != 0)
+    return 0;
+  pa = walkaddr(myproc()->pagetable, PGROUNDDOWN(va));
+  if(pa == 0 && pagefault(myproc()->pagetable, va, 1) == 0)
+    pa = walkaddr(myproc()->pagetable, PGROUNDDOWN(va));
+  if(pa == 0)
+    return 0;
+  return pa + (va - PGROUNDDOWN(va));
+}
+
+static struct spinlock *
+futex_lock(uint64 key)
+{
+  return &futexlocks[(key >> 2) % NFUTEXLOCK];
+}
+
+// futex_wait(addr, val): if the word at addr still holds val,
+// sleep until a futex_wake() on it. Returns 0 once woken, -1 if
+// the word had changed, addr is bad, or the process was killed.
+uint64
+sys_futex_wait(void)
+{
+  uint64 addr, key;
+  int val;
+  struct spinlock *lk;
+
+  argaddr(0, &addr);
+  argint(1, &val);
+  if((key = futex_key(addr)) == 0)
+    return -1;
+
+  lk = futex_lock(key);
+  acquire(lk);
+  if(*(volatile uint*)key != (uint)val || killed(myproc())){
+    release(lk);
+    return -1;
+  }
+  sleep_exclusive((void*)key, lk);
+  release(lk);
+  return 0;
+}
+
+// futex_wake(addr, n): wake up to n processes waiting on the word
+// at addr, or all of them if n < 0. Returns the number woken.
+uint64
+sys_futex_wake(void)
+{
+  uint64 addr, key;
+  int n, woken;
+  struct spinlock *lk;
+
+  argaddr(0, &addr);
+  argint(1, &n);
+  if((key = futex_key(addr)) == 0)
+    return -1;
+  if(n == 0)
+    return 0;
+
+  lk = futex_lock(key);
+  acquire(lk);
+  woken = wakeup_n((void*)key, n);
+  release(lk);
+  return woken;
+}
@@ -1,42 +1,205 @@
 // Physical memory allocator, for user processes,
 // kernel stacks, page-table pages,
 // and pipe buffers. Allocates whole 4096-byte pages.
+//
+// Free memory is kept by a buddy allocator: a block of order n is
+// 2^n pages, aligned to its size, and a freed block merges with its
+// buddy (the other half of the block of order n+1) whenever that is
+// free too. kalloc_pages() and kfree_pages() use it directly.
+//
+// Single pages, which are nearly all allocations, go through a
+// cache kept by each hart, so most kalloc()s and kfree()s take only
+// that hart's lock. An empty cache refills with a batch from the
+// buddy allocator, or failing that steals half of another hart's
+// cache; a cache that grows past KCACHE_MAX drains a batch back.
+// No code holds two of these locks at once.
+//
+// Pages from kalloc() carry a reference count, so copy-on-write
+// fork can share them: kdup() adds a reference, and kfree() frees
+// the page only when it drops the last one. Blocks of more than
+// one page from kalloc_pages() have none: they must go back
+// through kfree_pages(), and kfree() or kdup() of any page in one
+// panics.
+//
+// User memory that sbrk() grows is allocated only when touched, so
+// kreserve() promises it pages up front, and sbrk() fails when free
+// memory can't cover what is already promised.
 
 #include "types.h"
 #include "param.h"
 #include "memlayout.h"
 #include "spinlock.h"
 #include "riscv.h"
+#include "rbtree.h"
+#include "proc.h"
+#include "kmemstat.h"
 #include "defs.h"
 
+#define KBATCH     32   // pages moved to or from the buddy allocator at a time
+#define KCACHE_MAX 64   // most pages a hart's cache keeps
+#define KSLACK     16   // free pages kreserve() never promises, for
+                        // page-table pages and the kernel
+
 void freerange(void *pa_start, void *pa_end);
 
 extern char end[]; // first address after kernel.
                    // defined by kernel.ld.
 
+#define NPAGE     ((PHYSTOP - KERNBASE) / PGSIZE)
+#define PGIDX(pa) (((uint64)(pa) - KERNBASE) / PGSIZE)
+#define BFREE     0x80  // in kmem.state, with the order: a free block starts here
+
 struct run {
   struct run *next;
+  struct run *prev;   // only in the buddy lists
 };
 
+// the lock protects everything.
 struct {
   struct spinlock lock;
-  struct run *freelist;
+  struct run *freelist[NBUDDYORDER]; // free blocks of each order
+  int nfree;                         // free pages in all
+  uchar state[NPAGE];                // BFREE|order at the first page of a free block
+  uint64 start;                      // first page the allocator owns
+  struct buddystat st;
 } kmem;
 
+// references to each page from kalloc(); changed atomically.
+// KBLOCK marks the pages of a block from kalloc_pages().
+static int refs[NPAGE];
+#define KBLOCK (-1)
+
+// pages promised by kreserve() and not yet allocated; changed
+// atomically, and only raised with kmem.lock held.
+static long reserved;
+
+// the lock protects the list and the statistics.
+struct kcache {
+  struct spinlock lock;
+  struct run *freelist;
+  int nfree;
+  struct kmemstat st;
+} kcache[NCPU];
+
 void
 kinit()
 {
+  int i;
+
   initlock(&kmem.lock, "kmem");
+  for(i = 0; i < NCPU; i++)
+    initlock(&kcache[i].lock, "kcache");
+  kmem.start = PGROUNDUP((uint64)end);
   freerange(end, (void*)PHYSTOP);
 }
 
+static void buddy_free(uint64 pa, int order);
+
 void
 freerange(void *pa_start, void *pa_end)
 {
   char *p;
   p = (char*)PGROUNDUP((uint64)pa_start);
+  acquire(&kmem.lock);
   for(; p + PGSIZE <= (char*)pa_end; p += PGSIZE)
-    kfree(p);
+    buddy_free((uint64)p, 0);
+  release(&kmem.lock);
+}
+
+// kmem.lock must be held for the buddy_ functions.
+static void
+buddy_insert(uint64 pa, int order)
+{
+  struct run *r = (struct run*)pa;
+
+  r->prev = 0;
+  r->next = kmem.freelist[order];
+  if(r->next)
+    r->next->prev = r;
+  kmem.freelist[order] = r;
+  kmem.state[PGIDX(pa)] = BFREE | order;
+  kmem.st.nblock[order]++;
+}
+
+static void
+buddy_remove(uint64 pa, int order)
+{
+  struct run *r = (struct run*)pa;
+
+  if(r->prev)
+    r->prev->next = r->next;
+  else
+    kmem.freelist[order] = r->next;
+  if(r->next)
+    r->next->prev = r->prev;
+  kmem.state[PGIDX(pa)] = 0;
+  kmem.st.nblock[order]--;
+}
+
+// Free the block of order at pa, merging it with its buddy for as
+// long as the buddy is free.
+static void
+buddy_free(uint64 pa, int order)
+{
+  uint64 b;
+
+  kmem.nfree += 1 << order;
+  for(; order < NBUDDYORDER - 1; order++){
+    b = pa ^ (PGSIZE << order);
+    if(b < kmem.start || b + (PGSIZE << order) > PHYSTOP ||
+       kmem.state[PGIDX(b)] != (BFREE | order))
+      break;
+    buddy_remove(b, order);
+    kmem.st.merge++;
+    if(b < pa)
+      pa = b;
+  }
+  buddy_insert(pa, order);
+}
+
+// Allocate a block of order, splitting a bigger one if need be.
+// Returns 0 if there is none.
+static uint64
+buddy_alloc(int order)
+{
+  uint64 pa;
+  int o;
+
+  for(o = order; o < NBUDDYORDER && kmem.freelist[o] == 0; o++)
+    ;
+  if(o == NBUDDYORDER){
+    kmem.st.fail[order]++;
+    return 0;
+  }
+  pa = (uint64)kmem.freelist[o];
+  buddy_remove(pa, o);
+  while(o > order){
+    o--;
+    buddy_insert(pa + (PGSIZE << o), o);
+    kmem.st.split++;
+  }
+  kmem.nfree -= 1 << order;
+  kmem.st.alloc[order]++;
+  return pa;
+}
+
+// Detach up to n pages from the front of *list, which holds *nfree
+// pages. Returns the detached chain, or 0; *got is its length.
+static struct run *
+takepages(struct run **list, int *nfree, int n, int *got)
+{
+  struct run *head, **rp;
+  int i;
+
+  head = *list;
+  rp = list;
+  for(i = 0; i < n && *rp; i++)
+    rp = &(*rp)->next;
+  *list = *rp;
+  *rp = 0;
+  *nfree -= i;
+  *got = i;
+  return i ? head : 0;
 }
 
 // Free the page of physical memory pointed at by pa,
@@ -46,20 +209,97 @@ freerange(void *pa_start, void *pa_end)
 void
 kfree(void *pa)
 {
-  struct run *r;
+  struct run *r, *batch;
+  struct kcache *c;
+  int n;
 
   if(((uint64)pa % PGSIZE) != 0 || (char*)pa < end || (uint64)pa >= PHYSTOP)
     panic("kfree");
 
+  n = __sync_sub_and_fetch(&refs[PGIDX(pa)], 1);
+  if(n > 0)
+    return;
+  if(n < KBLOCK)
+    panic("kfree: page of a kalloc_pages block");
+  if(n < 0)
+    panic("kfree: not allocated");
+
   // Fill with junk to catch dangling refs.
   memset(pa, 1, PGSIZE);
 
   r = (struct run*)pa;
 
+  push_off();
+  c = &kcache[cpuid()];
+  acquire(&c->lock);
+  r->next = c->freelist;
+  c->freelist = r;
+  c->nfree++;
+  c->st.free++;
+  batch = 0;
+  if(c->nfree > KCACHE_MAX){
+    batch = takepages(&c->freelist, &c->nfree, KBATCH, &n);
+    c->st.drain++;
+  }
+  c->st.cached = c->nfree;
+  release(&c->lock);
+
+  if(batch){
+    acquire(&kmem.lock);
+    for(; batch; batch = r){
+      r = batch->next;
+      buddy_free((uint64)batch, 0);
+    }
+    release(&kmem.lock);
+  }
+  pop_off();
+}
+
+// Find pages for hart id's empty cache: a batch from the buddy
+// allocator, or else half of the first other cache that has any.
+// Returns one page for the caller and puts the rest in the cache.
+static struct run *
+refill(int id)
+{
+  struct kcache *c = &kcache[id];
+  struct run *batch, *r;
+  int i, n, stolen = 0;
+
+  batch = 0;
   acquire(&kmem.lock);
-  r->next = kmem.freelist;
-  kmem.freelist = r;
+  for(n = 0; n < KBATCH && (r = (struct run*)buddy_alloc(0)) != 0; n++){
+    r->next = batch;
+    batch = r;
+  }
   release(&kmem.lock);
+
+  for(i = 0; batch == 0 && i < NCPU; i++){
+    if(i == id)
+      continue;
+    acquire(&kcache[i].lock);
+    batch = takepages(&kcache[i].freelist, &kcache[i].nfree,
+                      (kcache[i].nfree + 1) / 2, &n);
+    kcache[i].st.cached = kcache[i].nfree;
+    release(&kcache[i].lock);
+    stolen = 1;
+  }
+
+  acquire(&c->lock);
+  if(batch == 0){
+    c->st.fail++;
+  } else {
+    if(stolen)
+      c->st.steal++;
+    else
+      c->st.refill++;
+    // still empty: interrupts are off, so nothing on this hart
+    // has freed a page since kalloc() looked.
+    c->freelist = batch->next;
+    c->nfree += n - 1;
+    c->st.cached = c->nfree;
+  }
+  release(&c->lock);
+  return batch;
 }
 
 // Allocate one 4096-byte page of physical memory.
@@ -69,14 +309,255 @@ void *
 kalloc(void)
 {
   struct run *r;
+  struct kcache *c;
+  int id;
 
-  acquire(&kmem.lock);
-  r = kmem.freelist;
-  if(r)
-    kmem.freelist = r->next;
-  release(&kmem.lock);
+  push_off();
+  id = cpuid();
+  c = &kcache[id];
+  acquire(&c->lock);
+  c->st.alloc++;
+  r = c->freelist;
+  if(r){
+    c->freelist = r->next;
+    c->nfree--;
+    c->st.hit++;
+    c->st.cached = c->nfree;
+  }
+  release(&c->lock);
+  if(r == 0)
+    r = refill(id);
+  pop_off();
 
-  if(r)
+  if(r){
     memset((char*)r, 5, PGSIZE); // fill with junk
+    refs[PGIDX(r)] = 1;
+  }
   return (void*)r;
 }
+
+// Add a reference to the page at pa, from kalloc(). It takes
+// one more kfree() to free it.
+void
+kdup(void *pa)
+{
+  int n;
+
+  if(((uint64)pa % PGSIZE) != 0 || (char*)pa < end || (uint64)pa >= PHYSTOP)
+    panic("kdup");
+  n = __sync_fetch_and_add(&refs[PGIDX(pa)], 1);
+  if(n == KBLOCK)
+    panic("kdup: page of a kalloc_pages block");
+  if(n <= 0)
+    panic("kdup: not allocated");
+}
+
+// The number of references to the page at pa.
+int
+krefs(void *pa)
+{
+  return *(volatile int*)&refs[PGIDX(pa)];
+}
+
+// Promise n pages to user memory that will be allocated when it is
+// touched, if free memory not yet promised covers them. kalloc()
+// doesn't hold promised pages back, so this bounds lazy growth by
+// what memory could back it rather than guaranteeing each fault.
+// Returns 0 on success, -1 if there isn't enough memory.
+int
+kreserve(long n)
+{
+  long avail;
+  int i;
+
+  if(n == 0)
+    return 0;
+  acquire(&kmem.lock);
+  avail = kmem.nfree - *(volatile long*)&reserved - KSLACK;
+  for(i = 0; i < NCPU; i++)
+    avail += *(volatile int*)&kcache[i].nfree;
+  if(n > avail){
+    release(&kmem.lock);
+    return -1;
+  }
+  __sync_fetch_and_add(&reserved, n);
+  release(&kmem.lock);
+  return 0;
+}
+
+// Give back n promised pages, because they were allocated or the
+// memory they were promised to is gone.
+void
+kunreserve(long n)
+{
+  if(__sync_sub_and_fetch(&reserved, n) < 0)
+    panic("kunreserve");
+}
+
+// Allocate 2^order physically contiguous pages, aligned to their
+// size. Returns 0 if there is no free block that big. Free the
+// block with kfree_pages(), never kfree().
+void *
+kalloc_pages(int order)
+{
+  uint64 pa;
+  int i;
+
+  if(order < 0 || order >= NBUDDYORDER)
+    return 0;
+  if(order == 0)
+    return kalloc();
+  acquire(&kmem.lock);
+  pa = buddy_alloc(order);
+  release(&kmem.lock);
+  if(pa){
+    memset((char*)pa, 5, PGSIZE << order); // fill with junk
+    for(i = 0; i < 1 << order; i++)
+      refs[PGIDX(pa) + i] = KBLOCK;
+  }
+  return (void*)pa;
+}
+
+// Free a block from kalloc_pages(order).
+void
+kfree_pages(void *pa, int order)
+{
+  int i;
+
+  if(order == 0){
+    kfree(pa);
+    return;
+  }
+  if(order < 0 || order >= NBUDDYORDER || (uint64)pa % (PGSIZE << order) != 0 ||
+     (uint64)pa < kmem.start || (uint64)pa + (PGSIZE << order) > PHYSTOP)
+    panic("kfree_pages");
+  for(i = 0; i < 1 << order; i++){
+    if(refs[PGIDX(pa) + i] != KBLOCK)
+      panic("kfree_pages: not a block");
+    refs[PGIDX(pa) + i] = 0;
+  }
+  memset(pa, 1, PGSIZE << order);
+  acquire(&kmem.lock);
+  buddy_free((uint64)pa, order);
+  release(&kmem.lock);
+}
+
+// kmemstat(buf, n): copy the statistics of up to n harts to buf.
+// Returns the number of pages free in the buddy allocator.
+uint64
+sys_kmemstat(void)
+{
+  uint64 buf;
+  int n, i, nfree;
+  struct kmemstat st;
+
+  argaddr(0, &buf);
+  argint(1, &n);
+  for(i = 0; i < NCPU && i < n; i++){
+    acquire(&kcache[i].lock);
+    st = kcache[i].st;
+    release(&kcache[i].lock);
+    if(copyout(myproc()->pagetable, buf + i * sizeof(st), (char*)&st, sizeof(st)) < 0)
+      return -1;
+  }
+  acquire(&kmem.lock);
+  nfree = kmem.nfree;
+  release(&kmem.lock);
+  return nfree;
+}
+
+// buddystat(buf): copy the buddy allocator's statistics to buf.
+// Returns the number of free pages it holds.
+uint64
+sys_buddystat(void)
+{
+  uint64 buf;
+  struct buddystat st;
+  int nfree;
+
+  argaddr(0, &buf);
+  acquire(&kmem.lock);
+  st = kmem.st;
+  nfree = kmem.nfree;
+  release(&kmem.lock);
+  if(copyout(myproc()->pagetable, buf, (char*)&st, sizeof(st)) < 0)
+    return -1;
+  return nfree;
+}
+
+// buddytest(): check the buddy allocator. With kmem.lock held, so
+// that no other hart's allocation gets in the way, take a block of
+// every order at once and check that each is aligned to its size
+// and that none overlap; then free each as its two halves and
+// check that they merge, leaving the free lists just as they were.
+// Then check kalloc_pages() and kfree_pages() themselves.
+// Returns 0 if all is well, -1 (after printing why) if not.
+uint64
+sys_buddytest(void)
+{
+  uint64 pa[NBUDDYORDER], merge, half;
+  int nblock[NBUDDYORDER], nfree, o, i, bad = 0;
+  void *p;
+
+  acquire(&kmem.lock);
+  nfree = kmem.nfree;
+  for(o = 0; o < NBUDDYORDER; o++)
+    nblock[o] = kmem.st.nblock[o];
+
+  for(o = 0; o < NBUDDYORDER; o++){
+    if((pa[o] = buddy_alloc(o)) == 0)
+      continue;         // memory too fragmented; nothing to check
+    if(pa[o] % (PGSIZE << o) != 0){
+      printf("buddytest: order %d block at %p not aligned\n", o, (void*)pa[o]);
+      bad = 1;
+    }
+    for(i = 0; i < o; i++){
+      if(pa[i] && pa[i] < pa[o] + (PGSIZE << o) && pa[o] < pa[i] + (PGSIZE << i)){
+        printf("buddytest: blocks of order %d and %d overlap\n", i, o);
+        bad = 1;
+      }
+    }
+  }
+
+  for(o = NBUDDYORDER - 1; o >= 0; o--){
+    if(pa[o] == 0)
+      continue;
+    if(o == 0){
+      buddy_free(pa[o], 0);
+      continue;
+    }
+    half = PGSIZE << (o - 1);
+    merge = kmem.st.merge;
+    buddy_free(pa[o], o - 1);
+    buddy_free(pa[o] + half, o - 1);
+    if(kmem.st.merge == merge){
+      printf("buddytest: halves of the order %d block didn't merge\n", o);
+      bad = 1;
+    }
+  }
+
+  if(kmem.nfree != nfree){
+    printf("buddytest: %d pages free, not %d\n", kmem.nfree, nfree);
+    bad = 1;
+  }
+  for(o = 0; o < NBUDDYORDER; o++){
+    if(kmem.st.nblock[o] != nblock[o]){
+      printf("buddytest: %d free blocks of order %d, not %d\n",
+             kmem.st.nblock[o], o, nblock[o]);
+      bad = 1;
+    }
+  }
+  release(&kmem.lock);
+
+  for(o = 1; o < NBUDDYORDER; o++){
+    if((p = kalloc_pages(o)) == 0)
+      continue;
+    if((uint64)p % (PGSIZE << o) != 0){
+      printf("buddytest: kalloc_pages(%d) gave %p, not aligned\n", o, p);
+      bad = 1;
+    }
+    kfree_pages(p, o);
+  }
+
+  return bad ? -1 : 0;
+}
@@ -0,0 +1,22 @@
+// Page allocator statistics, one record per hart.
+struct kmemstat {
+  uint64 alloc;      // kalloc() calls
+  uint64 hit;        // kalloc()s served from the hart's cache
+  uint64 refill;     // batches moved from the buddy allocator to the cache
+  uint64 steal;      // batches taken from another hart's cache
+  uint64 drain;      // batches moved from the cache to the buddy allocator
+  uint64 fail;       // kalloc()s that found no free page
+  uint64 free;       // kfree() calls
+  int cached;        // pages in the cache now
+};
+
+// Buddy allocator statistics. A block of order n is 2^n pages.
+#define NBUDDYORDER 11  // up to 4MB; order 9 is a 2MB megapage
+
+struct buddystat {
+  int nblock[NBUDDYORDER];    // free blocks of each order
+  uint64 alloc[NBUDDYORDER];  // blocks allocated of each order
+  uint64 fail[NBUDDYORDER];   // allocations of each order that failed
+  uint64 split;               // blocks split in two to allocate
+  uint64 merge;               // freed blocks merged with their buddy
+};
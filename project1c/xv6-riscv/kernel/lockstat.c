@@ -0,0 +1,136 @@
+// Lock statistics.
+//
+// initlock() and initsleeplock() look a lock's name up here once
+// and store the slot in the lock, so locks with the same name, such
+// as all the "proc" locks, share a record. While lockstaton is set
+// acquire() and acquiresleep() time themselves and report here.
+// Counts are kept per hart and only touched with interrupts off,
+// so they need no locking.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rbtree.h"
+#include "proc.h"
+#include "lockstat.h"
+#include "defs.h"
+
+struct lockcount {
+  uint64 acquire;
+  uint64 contended;
+  uint64 wait;
+  uint64 waitmax;
+  uint64 hold;
+  uint64 holdmax;
+};
+
+static char *names[NLOCKSTAT];
+static int sleeps[NLOCKSTAT];
+static struct lockcount counts[NCPU][NLOCKSTAT];
+volatile int lockstaton;
+
+// Return the statistics slot for locks called name, or 0 if the
+// table is full. Slots are claimed with compare-and-swap, since
+// this runs from initlock() and can't take a lock itself.
+int
+lockstat_key(char *name, int sleep)
+{
+  char *n;
+  int i;
+
+  if(name == 0)
+    return 0;
+  for(i = 0; i < NLOCKSTAT; i++){
+    n = names[i];
+    if(n == 0){
+      if(__sync_bool_compare_and_swap(&names[i], 0, name)){
+        sleeps[i] = sleep;
+        return i + 1;
+      }
+      n = names[i];
+    }
+    if(strncmp(n, name, LOCKSTAT_NAME) == 0)
+      return i + 1;
+  }
+  return 0;
+}
+
+// A lock using slot key was acquired after waiting wait.
+// Interrupts must be off.
+void
+lockstat_acquired(int key, uint64 wait, int contended)
+{
+  struct lockcount *c = &counts[cpuid()][key - 1];
+
+  c->acquire++;
+  if(contended){
+    c->contended++;
+    c->wait += wait;
+    if(wait > c->waitmax)
+      c->waitmax = wait;
+  }
+}
+
+// A lock using slot key was released after being held for hold.
+// Interrupts must be off.
+void
+lockstat_released(int key, uint64 hold)
+{
+  struct lockcount *c = &counts[cpuid()][key - 1];
+
+  c->hold += hold;
+  if(hold > c->holdmax)
+    c->holdmax = hold;
+}
+
+// lockstat(on): start (clearing the counts) or stop collecting
+// lock statistics. returns whether collection was on before.
+uint64
+sys_lockstat(void)
+{
+  int on, old;
+
+  argint(0, &on);
+  old = lockstaton;
+  if(on && !old)
+    memset(counts, 0, sizeof(counts));
+  lockstaton = on != 0;
+  return old;
+}
+
+// getlockstat(buf, n): copy up to n records, summed over harts,
+// to buf. returns the number of records copied.
+uint64
+sys_getlockstat(void)
+{
+  uint64 buf;
+  int n, i, j, got;
+  struct lockstat st;
+  struct lockcount *c;
+
+  argaddr(0, &buf);
+  argint(1, &n);
+  got = 0;
+  for(i = 0; i < NLOCKSTAT && got < n && names[i] != 0; i++){
+    memset(&st, 0, sizeof(st));
+    safestrcpy(st.name, names[i], sizeof(st.name));
+    st.sleep = sleeps[i];
+    for(j = 0; j < NCPU; j++){
+      c = &counts[j][i];
+      st.acquire += c->acquire;
+      st.contended += c->contended;
+      st.wait += c->wait;
+      st.hold += c->hold;
+      if(c->waitmax > st.waitmax)
+        st.waitmax = c->waitmax;
+      if(c->holdmax > st.holdmax)
+        st.holdmax = c->holdmax;
+    }
+    if(copyout(myproc()->pagetable, buf + got * sizeof(st), (char*)&st, sizeof(st)) < 0)
+      return -1;
+    got++;
+  }
+  return got;
+}
@@ -0,0 +1,17 @@
+// Lock statistics, one record per lock name.
+// Spinlock times are in cycles; sleeplock times are in time CSR
+// ticks, since a sleeplock can be taken on one hart and released
+// on another.
+#define NLOCKSTAT 64
+#define LOCKSTAT_NAME 16
+
+struct lockstat {
+  char name[LOCKSTAT_NAME];
+  int sleep;         // is this a sleeplock?
+  uint64 acquire;    // acquisitions
+  uint64 contended;  // acquisitions that had to wait
+  uint64 wait;       // total time waiting
+  uint64 waitmax;
+  uint64 hold;       // total time held
+  uint64 holdmax;
+};
@@ -1,5 +1,6 @@
 #include "types.h"
 #include "riscv.h"
+#include "trace.h"
 #include "defs.h"
 #include "param.h"
 #include "spinlock.h"
@@ -129,12 +130,17 @@ begin_op(void)
   acquire(&log.lock);
   while(1){
     if(log.committing){
-      sleep(&log, &log.lock);
+      sleep_exclusive(&log, &log.lock);
     } else if(log.lh.n + (log.outstanding+1)*MAXOPBLOCKS > LOGSIZE){
       // this op might exhaust log space; wait for commit.
-      sleep(&log, &log.lock);
+      sleep_exclusive(&log, &log.lock);
     } else {
       log.outstanding += 1;
+      // waiters are woken one at a time; if another op
+      // would still fit, wake the next one.
+      if(log.lh.n + (log.outstanding+1)*MAXOPBLOCKS <= LOGSIZE)
+        wakeup_one(&log);
+      TRACE(TR_BEGIN_OP, log.outstanding, 0);
       release(&log.lock);
       break;
     }
@@ -159,8 +165,9 @@ end_op(void)
     // begin_op() may be waiting for log space,
     // and decrementing log.outstanding has decreased
     // the amount of reserved space.
-    wakeup(&log);
+    wakeup_one(&log);
   }
+  TRACE(TR_END_OP, log.outstanding, do_commit);
   release(&log.lock);
 
   if(do_commit){
@@ -169,7 +176,7 @@ end_op(void)
     commit();
     acquire(&log.lock);
     log.committing = 0;
-    wakeup(&log);
+    wakeup_one(&log);
     release(&log.lock);
   }
 }
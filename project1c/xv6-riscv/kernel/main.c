@@ -17,9 +17,13 @@ main()
     printf("xv6 kernel is booting\n");
     printf("\n");
     kinit();         // physical page allocator
+    slabinit();      // small object allocator
     kvminit();       // create kernel page table
     kvminithart();   // turn on paging
     procinit();      // process table
+    profinit();      // sampling profiler
+    traceinit();     // event tracing
+    futexinit();     // futex wait queue locks
     trapinit();      // trap vectors
     trapinithart();  // install kernel trap vector
     plicinit();      // set up interrupt controller
@@ -27,6 +31,7 @@ main()
     binit();         // buffer cache
     iinit();         // inode table
     fileinit();      // file table
+    pipeinit();      // pipe cache
     virtio_disk_init(); // emulated hard disk
     userinit();      // first user process
     __sync_synchronize();
@@ -27,6 +27,7 @@
 
 // core local interruptor (CLINT), which contains the timer.
 #define CLINT 0x2000000L
+#define CLINT_MSIP(hartid) (CLINT + 4*(hartid)) // software interrupt (IPI) pending.
 #define CLINT_MTIMECMP(hartid) (CLINT + 0x4000 + 8*(hartid))
 #define CLINT_MTIME (CLINT + 0xBFF8) // cycles since boot.
 
@@ -62,6 +63,11 @@
 //   fixed-size stack
 //   expandable heap
 //   ...
+//   trapframes of threads made by clone()
 //   TRAPFRAME (p->trapframe, used by the trampoline)
 //   TRAMPOLINE (the same page as in the kernel)
 #define TRAPFRAME (TRAMPOLINE - PGSIZE)
+
+// threads share a page table, so each maps its trapframe at its
+// own address below TRAPFRAME, by its index in proc[].
+#define THREADFRAME(i) (TRAPFRAME - ((i)+1)*PGSIZE)
@@ -3,7 +3,9 @@
 #include "memlayout.h"
 #include "riscv.h"
 #include "spinlock.h"
+#include "rbtree.h"
 #include "proc.h"
+#include "trace.h"
 #include "defs.h"
 
 struct cpu cpus[NCPU];
@@ -17,6 +19,10 @@ struct spinlock pid_lock;
 
 extern void forkret(void);
 static void freeproc(struct proc *p);
+static void sched_forget(struct proc *p);
+static void sched_fork(struct proc *parent, struct proc *child, int cpu);
+static void dl_release(struct proc *p);
+static int rq_idlest(void);
 
 extern char trampoline[]; // trampoline.S
 
@@ -26,6 +32,23 @@ extern char trampoline[]; // trampoline.S
 // must be acquired before any p->lock.
 struct spinlock wait_lock;
 
+// Where struct vmshares come from. A vmshare's lock is acquired
+// after any p->lock.
+static struct kmem_cache *vmsharecache;
+
+// Hash table of wait queues for sleep() and wakeup().
+// A waitq lock is acquired after the lock passed to sleep()
+// and before any p->lock.
+#define WAITQ_SHIFT 6
+#define NWAITQ (1 << WAITQ_SHIFT)
+struct waitq waitqs[NWAITQ];
+
+// Protects dlTotalBw and each p->dlBw: the share of a cpu reserved
+// by deadline processes, in units of 1/(1 << DL_BW_SHIFT).
+// Acquired after p->lock.
+struct spinlock dl_lock;
+uint64 dlTotalBw;
+
 // Allocate a page for each process's kernel stack.
 // Map it high in memory, followed by an invalid
 // guard page.
@@ -50,6 +73,12 @@ void procinit(void)
 
   initlock(&pid_lock, "nextpid");
   initlock(&wait_lock, "wait_lock");
+  vmsharecache = kmem_cache_create("vmshare", sizeof(struct vmshare));
+  initlock(&dl_lock, "dl");
+  for (struct cpu *c = cpus; c < &cpus[NCPU]; c++)
+    initlock(&c->rq.lock, "runq");
+  for (struct waitq *wq = waitqs; wq < &waitqs[NWAITQ]; wq++)
+    initlock(&wq->lock, "waitq");
   for (p = proc; p < &proc[NPROC]; p++)
   {
     initlock(&p->lock, "proc");
@@ -102,10 +131,11 @@ int allocpid()
 
 // Look in the process table for an UNUSED proc.
 // If found, initialize state required to run in the kernel,
-// and return with p->lock held.
+// and return with p->lock held. The proc gets an empty user page
+// table, or, for a thread, shares the caller's.
 // If there are no free procs, or a memory allocation fails, return 0.
 static struct proc *
-allocproc(void)
+allocproc(int thread)
 {
   struct proc *p;
 
@@ -135,13 +165,41 @@ found:
     return 0;
   }
 
-  // An empty user page table.
-  p->pagetable = proc_pagetable(p);
-  if (p->pagetable == 0)
+  if (thread)
   {
-    freeproc(p);
-    release(&p->lock);
-    return 0;
+    // The caller's page table, with our trapframe mapped
+    // where no other thread's is. clone() has given the caller
+    // a vmshare.
+    struct proc *pp = myproc();
+    struct vmshare *vs = pp->vmshare;
+
+    p->tfva = THREADFRAME(p - proc);
+    acquire(&vs->lock);
+    if (mappages(pp->pagetable, p->tfva, PGSIZE,
+                 (uint64)(p->trapframe), PTE_R | PTE_W) < 0)
+    {
+      release(&vs->lock);
+      freeproc(p);
+      release(&p->lock);
+      return 0;
+    }
+    p->pagetable = pp->pagetable;
+    p->sz = pp->sz;
+    p->vmshare = vs;
+    vs->nproc++;
+    release(&vs->lock);
+  }
+  else
+  {
+    // An empty user page table.
+    p->tfva = TRAPFRAME;
+    p->pagetable = proc_pagetable(p);
+    if (p->pagetable == 0)
+    {
+      freeproc(p);
+      release(&p->lock);
+      return 0;
+    }
   }
 
   // Set up new context to start executing at forkret,
@@ -150,6 +208,10 @@ found:
   p->context.ra = (uint64)forkret;
   p->context.sp = p->kstack + PGSIZE;
 
+  p->tickets = STRIDE_DEFAULT_TICKETS;
+  p->nice = 0;
+  p->stridePass = 0;
+
   // Initialize MLFQ info
   p->mlfqInfo.addedToMLFQ = 0;        // Not added to MLFQ queue initially
   p->mlfqInfo.priority = 0;           // Start with priority 0
@@ -169,19 +231,45 @@ found:
 static void
 freeproc(struct proc *p)
 {
+  if (p->pagetable)
+  {
+    // Only the last thread using a page table frees it.
+    struct vmshare *vs = p->vmshare;
+    int last = 1;
+
+    if (vs)
+    {
+      acquire(&vs->lock);
+      last = --vs->nproc == 0;
+      if (!last)
+        uvmunmap(p->pagetable, p->tfva, 1, 0);
+      release(&vs->lock);
+      if (last)
+        kmem_cache_free(vmsharecache, vs);
+      p->vmshare = 0;
+    }
+    if (last)
+      proc_freepagetable(p->pagetable, p->sz, p->tfva);
+    p->pagetable = 0;
+  }
   if (p->trapframe)
     kfree((void *)p->trapframe);
   p->trapframe = 0;
-  if (p->pagetable)
-    proc_freepagetable(p->pagetable, p->sz);
-  p->pagetable = 0;
+  p->tfva = 0;
   p->sz = 0;
   p->pid = 0;
   p->parent = 0;
+  p->isthread = 0;
   p->name[0] = 0;
+  p->alarmInterval = 0;
+  p->alarmHandler = 0;
+  p->alarmTicks = 0;
+  p->alarmActive = 0;
   p->chan = 0;
   p->killed = 0;
   p->xstate = 0;
+  sched_forget(p);
+  dl_release(p);
   p->state = UNUSED;
 
   // Set the fields I added to 0
@@ -191,6 +279,7 @@ freeproc(struct proc *p)
   p->preemptCount = 0;
   p->trapCount = 0;
   p->sleepCount = 0;
+  memset(&p->lat, 0, sizeof(p->lat));
 
   // fields fields for MLFQ process information
   p->mlfqInfo.addedToMLFQ = 0;        // Not added to MLFQ queue initially
@@ -226,9 +315,9 @@ proc_pagetable(struct proc *p)
     return 0;
   }
 
-  // map the trapframe page just below the trampoline page, for
-  // trampoline.S.
-  if (mappages(pagetable, TRAPFRAME, PGSIZE,
+  // map the trapframe page just below the trampoline page (or
+  // lower, for a thread), for trampoline.S.
+  if (mappages(pagetable, p->tfva, PGSIZE,
                (uint64)(p->trapframe), PTE_R | PTE_W) < 0)
   {
     uvmunmap(pagetable, TRAMPOLINE, 1, 0);
@@ -239,15 +328,37 @@ proc_pagetable(struct proc *p)
   return pagetable;
 }
 
-// Free a process's page table, and free the
-// physical memory it refers to.
-void proc_freepagetable(pagetable_t pagetable, uint64 sz)
+// Free a process's page table, with its trapframe mapped at
+// tfva, and free the physical memory it refers to.
+void proc_freepagetable(pagetable_t pagetable, uint64 sz, uint64 tfva)
 {
   uvmunmap(pagetable, TRAMPOLINE, 1, 0);
-  uvmunmap(pagetable, TRAPFRAME, 1, 0);
+  uvmunmap(pagetable, tfva, 1, 0);
   uvmfree(pagetable, sz);
 }
 
+// Does p, the caller, have threads sharing its memory? Only p adds
+// threads, so a 0 stays 0 until p calls clone(), and needs no lock;
+// a 1 may go stale as threads exit, which only costs taking the
+// vmshare lock when it isn't needed.
+int vmshared(struct proc *p)
+{
+  struct vmshare *vs = p->vmshare;
+
+  return vs != 0 && *(volatile int *)&vs->nproc > 1;
+}
+
+// p, with no threads left, is done with its old page table;
+// see exec().
+void vmunshare(struct proc *p)
+{
+  if (p->vmshare)
+  {
+    kmem_cache_free(vmsharecache, p->vmshare);
+    p->vmshare = 0;
+  }
+}
+
 // a user program that calls exec("/init")
 // assembled from ../user/initcode.S
 // od -t xC ../user/initcode
@@ -265,7 +376,7 @@ void userinit(void)
 {
   struct proc *p;
 
-  p = allocproc();
+  p = allocproc(0);
   initproc = p;
 
   // allocate one user page and copy initcode's instructions
@@ -280,32 +391,83 @@ void userinit(void)
   safestrcpy(p->name, "initcode", sizeof(p->name));
   p->cwd = namei("/");
 
-  p->state = RUNNABLE;
+  p->cpu = 0;
+  setrunnable(p);
 
   release(&p->lock);
 }
 
-// Grow or shrink user memory by n bytes.
+// Grow or shrink user memory by n bytes, setting *oldsz to the
+// size before. Threads sharing the memory see the new size too.
+// Growing only moves the size: pagefault() maps each page when it
+// is first touched, from pages kreserve() promises now, so growth
+// fails when memory couldn't back it. Memory shared with threads can't shrink: their
+// harts may still have the pages in their TLBs, and there is no
+// TLB shootdown, so the pages can't be freed.
 // Return 0 on success, -1 on failure.
-int growproc(int n)
+int growproc(int n, uint64 *oldsz)
 {
   uint64 sz;
-  struct proc *p = myproc();
+  struct proc *pp, *p = myproc();
+  struct vmshare *vs = vmshared(p) ? p->vmshare : 0;
 
-  sz = p->sz;
+  if (vs)
+    acquire(&vs->lock);
+  sz = *oldsz = p->sz;
   if (n > 0)
   {
-    if ((sz = uvmalloc(p->pagetable, sz, sz + n, PTE_W)) == 0)
-    {
-      return -1;
-    }
+    // stay clear of the thread trapframes at the top.
+    if (sz + n > THREADFRAME(NPROC - 1) ||
+        kreserve((PGROUNDUP(sz + n) - PGROUNDUP(sz)) / PGSIZE) < 0)
+      goto bad;
+    sz += n;
   }
   else if (n < 0)
   {
+    if (vs && vs->nproc > 1)
+      goto bad;
     sz = uvmdealloc(p->pagetable, sz, sz + n);
   }
-  p->sz = sz;
+  if (vs)
+  {
+    for (pp = proc; pp < &proc[NPROC]; pp++)
+      if (pp->vmshare == vs)
+        pp->sz = sz;
+    release(&vs->lock);
+  }
+  else
+  {
+    p->sz = sz;
+  }
   return 0;
+
+bad:
+  if (vs)
+    release(&vs->lock);
+  return -1;
+}
+
+// Handle a fault at va, by a user load or store (write), in the
+// current process's pagetable; see uvmfault(). copyin() and
+// copyout() call this too, for pages the process hasn't touched.
+// The vmshare lock keeps threads from faulting the same page in
+// at once; a process without threads takes no lock.
+// Returns 0 if the access can be retried, -1 if not.
+int pagefault(pagetable_t pagetable, uint64 va, int write)
+{
+  struct proc *p = myproc();
+  struct vmshare *vs;
+  int r;
+
+  if (p == 0 || pagetable != p->pagetable)
+    return -1;
+  if (!vmshared(p))
+    return uvmfault(pagetable, va, p->sz, write, 0);
+  vs = p->vmshare;
+  acquire(&vs->lock);
+  r = uvmfault(pagetable, va, p->sz, write, vs->nproc > 1);
+  release(&vs->lock);
+  return r;
 }
 
 // Create a new process, copying the parent.
@@ -317,19 +479,25 @@ int fork(void)
   struct proc *p = myproc();
 
   // Allocate process.
-  if ((np = allocproc()) == 0)
+  if ((np = allocproc(0)) == 0)
   {
     return -1;
   }
 
-  // Copy user memory from parent to child.
-  if (uvmcopy(p->pagetable, np->pagetable, p->sz) < 0)
+  // Share user memory with the child, copy-on-write. A parent
+  // with threads gets a copy made now instead, since its threads
+  // may hold writable TLB entries for the pages. Neither holds the
+  // vmshare lock: a single-threaded parent has no one to race
+  // with, and shared memory only grows, with pages mapped at
+  // most once, so the copy sees each page mapped or not at all.
+  uint64 sz = p->sz;
+  if (uvmcopy(p->pagetable, np->pagetable, sz, !vmshared(p)) < 0)
   {
     freeproc(np);
     release(&np->lock);
     return -1;
   }
-  np->sz = p->sz;
+  np->sz = sz;
 
   // copy saved user registers.
   *(np->trapframe) = *(p->trapframe);
@@ -354,13 +522,83 @@ int fork(void)
   release(&wait_lock);
 
   acquire(&np->lock);
-  np->state = RUNNABLE;
+  np->tickets = p->tickets;
+  np->nice = p->nice;
+  sched_fork(p, np, rq_idlest());
+  setrunnable(np);
+  release(&np->lock);
+
+  return pid;
+}
+
+// Create a thread that shares the caller's memory and starts at
+// fn(arg) with its stack pointer at stack. It gets copies of the
+// caller's file descriptors and current directory, so open files
+// are shared but the descriptor table is not. Returns the thread's
+// pid, for join().
+int clone(uint64 fn, uint64 arg, uint64 stack)
+{
+  int i, pid;
+  struct proc *np;
+  struct proc *p = myproc();
+
+  if (stack % 16 != 0)
+    return -1;
+
+  // Threads never share copy-on-write pages; see uvmuncow().
+  // Until there is a thread, only this proc uses the page table.
+  if (!vmshared(p) && uvmuncow(p->pagetable, p->sz) < 0)
+    return -1;
+  if (p->vmshare == 0)
+  {
+    struct vmshare *vs = kmem_cache_alloc(vmsharecache);
+    if (vs == 0)
+      return -1;
+    initlock(&vs->lock, "vmshare");
+    vs->nproc = 1;
+    p->vmshare = vs;
+  }
+
+  if ((np = allocproc(1)) == 0)
+  {
+    return -1;
+  }
+
+  // start from the caller's registers, so gp and tp carry over.
+  *(np->trapframe) = *(p->trapframe);
+  np->trapframe->epc = fn;
+  np->trapframe->sp = stack;
+  np->trapframe->a0 = arg;
+  np->trapframe->ra = 0;
+
+  for (i = 0; i < NOFILE; i++)
+    if (p->ofile[i])
+      np->ofile[i] = filedup(p->ofile[i]);
+  np->cwd = idup(p->cwd);
+
+  safestrcpy(np->name, p->name, sizeof(p->name));
+
+  pid = np->pid;
+
+  release(&np->lock);
+
+  acquire(&wait_lock);
+  np->parent = p;
+  np->isthread = 1;
+  release(&wait_lock);
+
+  acquire(&np->lock);
+  np->tickets = p->tickets;
+  np->nice = p->nice;
+  sched_fork(p, np, rq_idlest());
+  setrunnable(np);
   release(&np->lock);
 
   return pid;
 }
 
 // Pass p's abandoned children to init.
+// Threads become ordinary children, for init's wait().
 // Caller must hold wait_lock.
 void reparent(struct proc *p)
 {
@@ -371,11 +609,48 @@ void reparent(struct proc *p)
     if (pp->parent == p)
     {
       pp->parent = initproc;
+      pp->isthread = 0;
       wakeup(initproc);
     }
   }
 }
 
+// Kill the threads sharing p's memory, and wait until every one
+// has exited, so none is still running on it once p is gone; they
+// don't outlive the process that made them. Each pass kills again,
+// in case a thread made another while the last pass was scanning.
+// Exiting threads call wakeup(vmshare) in exit().
+static void
+kill_threads(struct proc *p)
+{
+  struct proc *pp;
+  int running;
+
+  acquire(&wait_lock);
+  for (;;)
+  {
+    running = 0;
+    for (pp = proc; pp < &proc[NPROC]; pp++)
+    {
+      if (pp == p)
+        continue;
+      acquire(&pp->lock);
+      if (pp->vmshare == p->vmshare && pp->state != UNUSED && pp->state != ZOMBIE)
+      {
+        running = 1;
+        pp->killed = 1;
+        if (pp->state == SLEEPING)
+          setrunnable(pp);
+      }
+      release(&pp->lock);
+    }
+    if (!running)
+      break;
+    sleep(p->vmshare, &wait_lock);
+  }
+  release(&wait_lock);
+}
+
 // Exit the current process.  Does not return.
 // An exited process remains in the zombie state
 // until its parent calls wait().
@@ -386,6 +661,14 @@ void exit(int status)
   if (p == initproc)
     panic("init exiting");
 
+  // A thread's exit ends just that thread; the process's ends
+  // all of them.
+  acquire(&wait_lock);
+  int isthread = p->isthread;
+  release(&wait_lock);
+  if (!isthread && p->vmshare)
+    kill_threads(p);
+
   // Close all open files.
   for (int fd = 0; fd < NOFILE; fd++)
   {
@@ -407,8 +690,11 @@ void exit(int status)
   // Give any children to init.
   reparent(p);
 
-  // Parent might be sleeping in wait().
+  // Parent might be sleeping in wait(), and the process whose
+  // threads we share in kill_threads().
   wakeup(p->parent);
+  if (p->vmshare)
+    wakeup(p->vmshare);
 
   acquire(&p->lock);
 
@@ -438,7 +724,7 @@ int wait(uint64 addr)
     havekids = 0;
     for (pp = proc; pp < &proc[NPROC]; pp++)
     {
-      if (pp->parent == p)
+      if (pp->parent == p && !pp->isthread)
       {
         // make sure the child isn't still in exit() or swtch().
         acquire(&pp->lock);
@@ -476,321 +762,1258 @@ int wait(uint64 addr)
   }
 }
 
-int mlfqFlag = 0; // Define and initialize the flag
+// Wait for thread tid, or any thread if tid is 0, made by this
+// process with clone() to exit. Copies its exit status to addr,
+// if non-zero, and returns its pid; -1 if there is no such thread.
+int join(int tid, uint64 addr)
+{
+  struct proc *pp;
+  int havekids, pid;
+  struct proc *p = myproc();
+
+  acquire(&wait_lock);
+
+  for (;;)
+  {
+    havekids = 0;
+    for (pp = proc; pp < &proc[NPROC]; pp++)
+    {
+      if (pp->parent == p && pp->isthread && (tid == 0 || pp->pid == tid))
+      {
+        acquire(&pp->lock);
+
+        havekids = 1;
+        if (pp->state == ZOMBIE)
+        {
+          pid = pp->pid;
+          if (addr != 0 && copyout(p->pagetable, addr, (char *)&pp->xstate,
+                                   sizeof(pp->xstate)) < 0)
+          {
+            release(&pp->lock);
+            release(&wait_lock);
+            return -1;
+          }
+          freeproc(pp);
+          release(&pp->lock);
+          release(&wait_lock);
+          return pid;
+        }
+        release(&pp->lock);
+      }
+    }
+
+    if (!havekids || killed(p))
+    {
+      release(&wait_lock);
+      return -1;
+    }
+
+    sleep(p, &wait_lock);
+  }
+}
+
+// The scheduling class in use. activeClass and mlfqParams only
+// change with every run queue lock held, so holding any one of
+// them is enough to read them.
+static struct schedClass rrClass, mlfqClass, strideClass, cfsClass;
+static struct schedClass *activeClass = &rrClass;
 
+// Defaults until startMLFQ() sets them.
 struct
 {
   int m; // Number of priority levels
   int n; // Max number of ticks a process can stay at priority level m-1 before being boosted to 0
-} mlfqParams;
+} mlfqParams = {3, 100};
+
+// Quanta, boost period and demotion rule; see setMLFQPolicy().
+// Changes with every run queue lock held, like mlfqParams.
+struct MLFQPolicy mlfqPolicy = {
+    .quantum = {2, 4, 6, 8, 10, 12, 14, 16, 18, 20},
+    .boostPeriod = 0,
+    .demotion = MLFQ_DEMOTE_ALLOTMENT,
+};
 
-// Declare MLFQ queues globally
-struct mlfqQueue mlfqQueues[MLFQ_MAX_LEVEL];
+// ticks at the last global boost.
+uint mlfqLastBoost;
 
-// Function to insert a process into the MLFQ queue
-void mlfq_enque(struct mlfqQueue *queue, struct proc *proc)
+// Ticks between load balancing passes of each cpu.
+#define BALANCE_INTERVAL 10
+
+// Append p to the tail of queue q.
+static void
+procq_append(struct procQueue *q, struct proc *p)
 {
-  struct mlfqQueueElement *newElement = (struct mlfqQueueElement *)kalloc();
-  if (newElement == 0)
-  {
-    return; // Allocation failed
-  }
-  newElement->proc = proc;
-  newElement->next = 0;
-  newElement->prev = 0;
+  p->qNext = 0;
+  p->qPrev = q->tail;
+  if (q->tail != 0)
+    q->tail->qNext = p;
+  else
+    q->head = p;
+  q->tail = p;
+}
+
+// Insert p at the head of queue q.
+static void
+procq_push(struct procQueue *q, struct proc *p)
+{
+  p->qPrev = 0;
+  p->qNext = q->head;
+  if (q->head != 0)
+    q->head->qPrev = p;
+  else
+    q->tail = p;
+  q->head = p;
+}
+
+// Unlink p from queue q.
+static void
+procq_remove(struct procQueue *q, struct proc *p)
+{
+  if (p->qPrev != 0)
+    p->qPrev->qNext = p->qNext;
+  else
+    q->head = p->qNext;
+  if (p->qNext != 0)
+    p->qNext->qPrev = p->qPrev;
+  else
+    q->tail = p->qPrev;
+  p->qNext = 0;
+  p->qPrev = 0;
+}
+
+static int
+procheap_less(struct procHeap *h, int i, int j)
+{
+  return h->procs[i]->heapKey < h->procs[j]->heapKey;
+}
 
-  // Check if the queue is empty
-  if (queue->head == 0)
+static void
+procheap_swap(struct procHeap *h, int i, int j)
+{
+  struct proc *t = h->procs[i];
+
+  h->procs[i] = h->procs[j];
+  h->procs[j] = t;
+  h->procs[i]->heapIdx = i;
+  h->procs[j]->heapIdx = j;
+}
+
+// Move the process at i up until its parent's key is no larger.
+static void
+procheap_up(struct procHeap *h, int i)
+{
+  while (i > 0 && procheap_less(h, i, (i - 1) / 2))
   {
-    queue->head = newElement;
-    return;
+    procheap_swap(h, i, (i - 1) / 2);
+    i = (i - 1) / 2;
   }
+}
 
-  // Find the tail of the queue
-  struct mlfqQueueElement *tail = queue->head;
-  while (tail->next != 0)
+// Move the process at i down until its children's keys are no smaller.
+static void
+procheap_down(struct procHeap *h, int i)
+{
+  for (;;)
   {
-    tail = tail->next;
+    int min = i, l = 2 * i + 1, r = 2 * i + 2;
+
+    if (l < h->n && procheap_less(h, l, min))
+      min = l;
+    if (r < h->n && procheap_less(h, r, min))
+      min = r;
+    if (min == i)
+      return;
+    procheap_swap(h, i, min);
+    i = min;
   }
+}
 
-  // Insert the new element at the end
-  tail->next = newElement;
-  newElement->prev = tail;
+// Add p, keyed by p->heapKey, to heap h.
+static void
+procheap_insert(struct procHeap *h, struct proc *p)
+{
+  h->procs[h->n] = p;
+  p->heapIdx = h->n++;
+  procheap_up(h, p->heapIdx);
 }
 
-// Function to remove and return the first process from the MLFQ queue
-struct proc *mlfq_deque(struct mlfqQueue *queue)
+// Remove p from heap h.
+static void
+procheap_remove(struct procHeap *h, struct proc *p)
 {
-  if (queue->head == 0)
-  {
-    return 0; // Queue is empty
-  }
+  int i = p->heapIdx;
 
-  // Get the first element
-  struct mlfqQueueElement *firstElement = queue->head;
-  struct proc *firstProc = firstElement->proc;
+  h->n--;
+  if (i == h->n)
+    return;
+  h->procs[i] = h->procs[h->n];
+  h->procs[i]->heapIdx = i;
+  procheap_up(h, i);
+  procheap_down(h, i);
+}
 
-  // Update the head of the queue
-  queue->head = firstElement->next;
-  if (queue->head != 0)
-  {
-    queue->head->prev = 0;
-  }
+// The process with the smallest key in h, or 0 if h is empty.
+static struct proc *
+procheap_min(struct procHeap *h)
+{
+  return h->n > 0 ? h->procs[0] : 0;
+}
+
+// Deadline processes, those that called sched_setdeadline(), run
+// ahead of the active class, earliest absolute deadline first, from
+// the dl heap of their cpu. They do not migrate. One that has used
+// its budget for the period is throttled: parked on dlThrottled,
+// not counted in nqueued, until its next period starts.
 
-  // Free the dequeued element
-  kfree((char *)firstElement);
+// Is time a before time b?
+static int
+dl_before(uint a, uint b)
+{
+  return (int)(a - b) < 0;
+}
 
-  return firstProc;
+// Start a new period for p at time start, with a full budget.
+static void
+dl_newperiod(struct proc *p, uint start)
+{
+  p->dlBudget = p->dlRuntime;
+  p->dlAbsDeadline = start + p->dlDeadline;
+  p->dlPeriodEnd = start + p->dlPeriod;
 }
 
-// Function to delete a specific process from the MLFQ queue
-void mlfq_delete(struct mlfqQueue *queue, struct proc *proc)
+static void
+dl_enqueue(struct runq *rq, struct proc *p, int flags)
 {
-  if (queue->head == 0)
+  if ((flags & ENQ_WAKEUP) && !dl_before(ticks, p->dlPeriodEnd))
+    dl_newperiod(p, ticks);
+
+  if (p->dlBudget <= 0)
   {
-    return; // Queue is empty
+    p->dlThrottled = 1;
+    procq_append(&rq->dlThrottled, p);
+    return;
   }
+  p->heapKey = p->dlAbsDeadline;
+  procheap_insert(&rq->dl, p);
+}
 
-  struct mlfqQueueElement *current = queue->head;
-  while (current != 0)
+static void
+dl_dequeue(struct runq *rq, struct proc *p)
+{
+  if (p->dlThrottled)
   {
-    if (current->proc == proc)
-    {
-      // Found the process, delete it from the queue
-      if (current->prev == 0)
-      {
-        // Process is at the head of the queue
-        queue->head = current->next;
-      }
-      else
-      {
-        current->prev->next = current->next;
-      }
-      if (current->next != 0)
-      {
-        current->next->prev = current->prev;
-      }
-      return;
-    }
-    current = current->next;
+    procq_remove(&rq->dlThrottled, p);
+    p->dlThrottled = 0;
   }
+  else
+    procheap_remove(&rq->dl, p);
 }
 
-// Per-CPU process scheduler.
-// Each CPU calls scheduler() after setting itself up.
-// Scheduler never returns.  It loops, doing:
-//  - choose a process to run.
-//  - swtch to start running that process.
-//  - eventually that process transfers control
-//    via swtch back to the scheduler.
-
-// Altered scheduler to include MLFQ_scheduler
-void scheduler(void)
+// Put p on rq, in the dl heap or under the active class. flags say
+// why it is being queued (ENQ_WAKEUP, ENQ_PREEMPT).
+// Caller must hold rq->lock.
+static void
+rq_add(struct runq *rq, struct proc *p, int flags)
 {
-  struct cpu *c = mycpu();
-  c->proc = 0;
-  for (;;)
+  // Start the latency clocks. Other flags mean p is only being
+  // moved between queues, and its clocks keep running.
+  if (flags & (ENQ_WAKEUP | ENQ_PREEMPT))
   {
-    // Avoid deadlock by ensuring that devices can interrupt.
-    intr_on();
-    if (mlfqFlag)
-    { // the flag indicates if MLFQ scheduler is running
-      MLFQ_scheduler(c);
-    }
-    else
-    {
-      RR_scheduler(c);
-    }
+    p->queuedAt = r_time();
+    p->wokenAt = (flags & ENQ_WAKEUP) ? p->queuedAt : 0;
   }
+
+  if (p->dlRuntime > 0)
+    dl_enqueue(rq, p, flags);
+  else
+    activeClass->enqueue(rq, p, flags);
+  p->onrq = 1;
+  if (!p->dlThrottled)
+    rq->nqueued++;
 }
 
-// Constructed from the existing scheduler
-void RR_scheduler(struct cpu *c)
+// Take p off rq. Caller must hold rq->lock.
+static void
+rq_remove(struct runq *rq, struct proc *p)
 {
-  struct proc *p;
-  for (p = proc; p < &proc[NPROC]; p++)
+  if (!p->dlThrottled)
+    rq->nqueued--;
+  if (p->dlRuntime > 0)
+    dl_dequeue(rq, p);
+  else
+    activeClass->dequeue(rq, p);
+  p->onrq = 0;
+}
+
+// Give each throttled process on rq whose next period has come a
+// new budget, and queue it to run. Caller must hold rq->lock.
+static void
+dl_unthrottle(struct runq *rq)
+{
+  struct proc *p, *next;
+
+  for (p = rq->dlThrottled.head; p != 0; p = next)
   {
-    acquire(&p->lock);
-    if (p->state == RUNNABLE)
-    {
-      // Switch to chosen process. It is the process's job
-      // to release its lock and then reacquire it
-      // before jumping back to us.
-      p->state = RUNNING;
-      c->proc = p;
-      swtch(&c->context, &p->context);
-      // Process is done running for now.
-      // It should have changed its p->state before coming back.
-      c->proc = 0;
-    }
-    release(&p->lock);
+    next = p->qNext;
+    if (dl_before(ticks, p->dlPeriodEnd))
+      continue;
+    procq_remove(&rq->dlThrottled, p);
+    p->dlThrottled = 0;
+    dl_newperiod(p, p->dlPeriodEnd);
+    p->heapKey = p->dlAbsDeadline;
+    procheap_insert(&rq->dl, p);
+    rq->nqueued++;
   }
 }
 
-void MLFQ_scheduler(struct cpu *c)
+// Charge running deadline process p a tick. Preempt once its budget
+// is gone, so it cannot run past its reservation, or when a process
+// with an earlier deadline is waiting.
+static int
+dl_tick(struct runq *rq, struct proc *p)
 {
-  struct proc *p = 0; // p is the process scheduled to run; initially it is none
-  int rr_index = 0;   // Initialize round-robin index
+  struct proc *next;
 
-  while (mlfqFlag)
-  { // each iteration is run every time when the scheduler gains control
+  if (--p->dlBudget <= 0)
+    return 1;
+  next = procheap_min(&rq->dl);
+  return next != 0 && dl_before(next->dlAbsDeadline, p->dlAbsDeadline);
+}
 
-    // Increment the tick count of p on the current queue
-    if (p != 0 && (p->state == RUNNABLE || p->state == RUNNING))
-    {
-      // Increment tick count of p on the current queue
-      p->mlfqInfo.ticks[p->mlfqInfo.priority]++;
-      p->mlfqInfo.tickCounts[p->mlfqInfo.priority]++;
-      //printf("(In MLFQ_scheduler) Tick count of process %d: %d\n", p->pid, p->mlfqInfo.ticks[p->mlfqInfo.priority]);
+// Give back the bandwidth p reserved, e.g. when it is freed.
+static void
+dl_release(struct proc *p)
+{
+  acquire(&dl_lock);
+  dlTotalBw -= p->dlBw;
+  p->dlBw = 0;
+  release(&dl_lock);
+  p->dlRuntime = 0;
+}
 
-      // Check if p’s time quantum for the current queue expires
-      if (p->mlfqInfo.ticks[p->mlfqInfo.priority] >= 2 * (p->mlfqInfo.priority + 1))
-      {
-        //printf("(In MLFQ_scheduler) Process %d exceeded its time quantum.\n", p->pid);
+// Lock the run queue p is on (or last ran from). p->cpu only
+// changes while p is queued, with that run queue locked, so check
+// it again once the lock is held.
+static struct runq *
+rq_lock_proc(struct proc *p)
+{
+  struct runq *rq;
 
-        if (p->mlfqInfo.priority < mlfqParams.m - 1)
-        {
-          // Move p to the next lower priority queue
-          struct mlfqQueue *lowerQueue = &mlfqQueues[p->mlfqInfo.priority + 1];
-          mlfq_enque(lowerQueue, p);
-          //printf("(In MLFQ_scheduler) Process %d moved to a lower priority queue.\n", p->pid);
-
-          // Clear the process from its previous queue
-          struct mlfqQueue *previousQueue = &mlfqQueues[p->mlfqInfo.priority];
-          mlfq_delete(previousQueue, p);
-          //printf("(In MLFQ_scheduler) Process %d removed from previous queue.\n", p->pid);
-
-          // Reset ticks for the current priority level
-          p->mlfqInfo.ticks[p->mlfqInfo.priority] = 0;
-          //printf("(In MLFQ_scheduler) Reset tick count for process %d at priority %d.\n", p->pid, p->mlfqInfo.priority);
-
-          // Increment the priority
-          p->mlfqInfo.priority++;
-        }
-        //It is in the lowest priority already
-        else
-        {
-          // Reset ticks for the current priority level only if the process will remain in the same queue
-          p->mlfqInfo.ticks[p->mlfqInfo.priority] = 0;
+  for (;;)
+  {
+    rq = &cpus[p->cpu].rq;
+    acquire(&rq->lock);
+    if (rq == &cpus[p->cpu].rq)
+      return rq;
+    release(&rq->lock);
+  }
+}
 
-          // Remove p from its current queue since it's at the maximum priority
-          // struct mlfqQueue *currentQueue = &mlfqQueues[p->mlfqInfo.priority];
-          // mlfq_delete(currentQueue, p);
-          // printf("(In MLFQ_scheduler) Process %d removed from current queue.\n", p->pid);
-        }
+// Lock two run queues, in cpu order to avoid deadlock.
+static void
+rq_lock2(struct runq *a, struct runq *b)
+{
+  if (a < b)
+  {
+    acquire(&a->lock);
+    acquire(&b->lock);
+  }
+  else
+  {
+    acquire(&b->lock);
+    acquire(&a->lock);
+  }
+}
 
-        // Set p to 0 (to indicate another process should be found to run next)
-        p = 0;
-        continue;
-      }
-    }
+static void
+rq_unlock2(struct runq *a, struct runq *b)
+{
+  release(&a->lock);
+  release(&b->lock);
+}
 
-    // Implement Rule 5: Increment the tick counts for the processes at the bottom queue and move each process who has stayed there for n ticks to the top queue
-    struct mlfqQueue *lastQueue = &mlfqQueues[mlfqParams.m - 1];
-    struct mlfqQueueElement *temp = lastQueue->head;
+// Lock every run queue, to change the scheduling policy.
+static void
+rq_lockall(void)
+{
+  for (struct cpu *c = cpus; c < &cpus[NCPU]; c++)
+    acquire(&c->rq.lock);
+}
 
-    while (temp != 0)
-    {
-      if (temp->proc->mlfqInfo.priority == mlfqParams.m - 1) // Check if process is at max priority
-      {
-          temp->proc->mlfqInfo.ticksAtMaxPriority++;
-          temp->proc->mlfqInfo.tickCounts[temp->proc->mlfqInfo.priority]++;
+static void
+rq_unlockall(void)
+{
+  for (struct cpu *c = &cpus[NCPU - 1]; c >= cpus; c--)
+    release(&c->rq.lock);
+}
 
-       // printf("IN RULE 5 LOGIC...");
-       // printf("(In MLFQ_scheduler) Process %d: Tick count at max priority: %d\n", temp->proc->pid, temp->proc->mlfqInfo.ticksAtMaxPriority);
-        if (temp->proc->mlfqInfo.ticksAtMaxPriority >= mlfqParams.n)
-        {
-          //printf("(In MLFQ_scheduler) Moving process %d to the top queue\n", temp->proc->pid);
-          // Move the process to the top queue
-          struct mlfqQueue *topQueue = &mlfqQueues[0];
-          mlfq_enque(topQueue, temp->proc);
-          // Remove the process from the bottom queue
-          //printf("(In MLFQ_scheduler) Removing process %d from the bottom queue\n", temp->proc->pid);
-          mlfq_delete(lastQueue, temp->proc);
-          // Reset tick count at max priority level
-          temp->proc->mlfqInfo.ticksAtMaxPriority = 0;
-          temp->proc->mlfqInfo.ticks[temp->proc->mlfqInfo.priority] = 0; // Reset tick count for the current priority level
-          // Adjust priority
-          //printf("(In MLFQ_scheduler) Process %d's original priority is %d\n", temp->proc->pid, temp->proc->mlfqInfo.priority);
-          temp->proc->mlfqInfo.priority = 0;
-          //printf("(In MLFQ_scheduler) Process %d's new priority is %d\n", temp->proc->pid, temp->proc->mlfqInfo.priority);
-          temp->proc->mlfqInfo.ticks[temp->proc->mlfqInfo.priority] = 0; // Reset tick count for the current priority level
-        }
-      }
-      temp = temp->next;
-    }
+// Index of the online cpu with the least queued work, for placing
+// new processes. Reads the counts without locks; it is only a hint.
+static int
+rq_idlest(void)
+{
+  int best = cpuid();
+
+  for (struct cpu *c = cpus; c < &cpus[NCPU]; c++)
+  {
+    if (c->online && c->rq.nqueued < cpus[best].rq.nqueued)
+      best = c - cpus;
+  }
+  return best;
+}
+
+// The online cpu other than self with the most queued work,
+// or 0 if none has any. Reads the counts without locks.
+static struct cpu *
+rq_busiest(struct cpu *self)
+{
+  struct cpu *busiest = 0;
+
+  for (struct cpu *c = cpus; c < &cpus[NCPU]; c++)
+  {
+    if (c == self || !c->online || c->rq.nqueued == 0)
+      continue;
+    if (busiest == 0 || c->rq.nqueued > busiest->rq.nqueued)
+      busiest = c;
+  }
+  return busiest;
+}
+
+// Add p to the bottom-level age list of rq, keeping it sorted by
+// arrival. New arrivals are always youngest, so this only walks
+// when a process migrates between cpus.
+static void
+mlfq_age_insert(struct runq *rq, struct proc *p)
+{
+  struct proc *prev = rq->mlfqBottom.tail;
+
+  while (prev != 0 && prev->mlfqBottomSince > p->mlfqBottomSince)
+    prev = prev->mlfqAgePrev;
+
+  p->mlfqAgePrev = prev;
+  p->mlfqAgeNext = prev != 0 ? prev->mlfqAgeNext : rq->mlfqBottom.head;
+  if (p->mlfqAgeNext != 0)
+    p->mlfqAgeNext->mlfqAgePrev = p;
+  else
+    rq->mlfqBottom.tail = p;
+  if (prev != 0)
+    prev->mlfqAgeNext = p;
+  else
+    rq->mlfqBottom.head = p;
+}
+
+// Remove p from the bottom-level age list of rq.
+static void
+mlfq_age_remove(struct runq *rq, struct proc *p)
+{
+  if (p->mlfqAgePrev != 0)
+    p->mlfqAgePrev->mlfqAgeNext = p->mlfqAgeNext;
+  else
+    rq->mlfqBottom.head = p->mlfqAgeNext;
+  if (p->mlfqAgeNext != 0)
+    p->mlfqAgeNext->mlfqAgePrev = p->mlfqAgePrev;
+  else
+    rq->mlfqBottom.tail = p->mlfqAgePrev;
+  p->mlfqAgeNext = 0;
+  p->mlfqAgePrev = 0;
+}
+
+// Is p on the bottom-level age list of its run queue? Only levels
+// below 0 age, so a single-level MLFQ never boosts.
+static int
+mlfq_at_bottom(struct proc *p)
+{
+  return activeClass == &mlfqClass && mlfqParams.m > 1 && p->mlfqInfo.priority == mlfqParams.m - 1;
+}
+
+// Move p to priority level. If p is queued it moves to the tail
+// of the new level. Caller must hold rq->lock, p's run queue.
+static void
+mlfq_setpriority(struct runq *rq, struct proc *p, int level)
+{
+  int queued = p->onrq;
+
+  if (queued)
+    rq_remove(rq, p);
+  if (mlfq_at_bottom(p))
+    mlfq_age_remove(rq, p);
+
+  p->mlfqInfo.ticks[p->mlfqInfo.priority] = 0;
+  p->mlfqInfo.priority = level;
+  p->mlfqInfo.ticks[level] = 0;
+
+  if (mlfq_at_bottom(p))
+  {
+    p->mlfqBottomSince = ticks;
+    mlfq_age_insert(rq, p);
+  }
+  if (queued)
+    rq_add(rq, p, 0);
+}
+
+// A process was just queued on cpus[target]. If that cpu is idle,
+// wake it; otherwise wake some other idle cpu so it can steal it.
+static void
+rq_kick(int target)
+{
+  // pairs with the fence in rq_idle(): either we see the cpu is
+  // idle, or it sees the process we queued.
+  __sync_synchronize();
 
-    // Add new processes (which haven’t been added to any queue yet) to queue 0
-    for (int i = 0; i < NPROC; i++)
+  if (cpus[target].idle)
+  {
+    ipi(target);
+    return;
+  }
+  for (struct cpu *c = cpus; c < &cpus[NCPU]; c++)
+  {
+    if (c->online && c->idle)
     {
-      if (proc[i].state == RUNNABLE && proc[i].mlfqInfo.addedToMLFQ == 0)
-      {
-        struct mlfqQueue *queue = &mlfqQueues[0];
-        mlfq_enque(queue, &proc[i]);
-        proc[i].mlfqInfo.addedToMLFQ = 1;
-        //printf("(In MLFQ_scheduler) Process %d added to queue 0.\n", proc[i].pid);
-      }
+      ipi(c - cpus);
+      return;
     }
-if(p == 0){
-    int highest_priority = __INT_MAX__;
-    struct proc *selected_proc = 0; // Initialize selected_proc to NULL
+  }
+}
+
+// Mark p RUNNABLE and put it on the run queue of the cpu it last
+// ran on; load balancing moves it if that cpu is busy.
+// Caller must hold p->lock.
+void setrunnable(struct proc *p)
+{
+  struct runq *rq;
+  int target;
+
+  p->state = RUNNABLE;
+  rq = rq_lock_proc(p);
+  target = p->cpu;
+  rq_add(rq, p, ENQ_WAKEUP);
+  release(&rq->lock);
+  rq_kick(target);
+}
+
+// Take p off the run queues for good, e.g. when it is freed.
+// Caller must hold p->lock.
+static void
+sched_forget(struct proc *p)
+{
+  struct runq *rq = rq_lock_proc(p);
+
+  if (p->onrq)
+    rq_remove(rq, p);
+  if (activeClass->exit)
+    activeClass->exit(rq, p);
+  release(&rq->lock);
+}
+
+// Implement Rule 5: move each process who has stayed at the bottom
+// level for n ticks to the top queue. The age list is sorted by
+// arrival, so this stops at the first process that is too young.
+// Caller must hold rq->lock.
+static void
+mlfq_boost(struct runq *rq)
+{
+  struct proc *p;
+
+  while ((p = rq->mlfqBottom.head) != 0 &&
+         (int)(ticks - p->mlfqBottomSince) >= mlfqParams.n)
+  {
+    p->mlfqInfo.ticksAtMaxPriority = 0;
+    mlfq_setpriority(rq, p, 0);
+  }
+}
+
+// Move every process back to the top queue. Caller must hold
+// every run queue lock.
+static void
+mlfq_boostall(void)
+{
+  struct proc *p;
 
-    // Find the highest priority
-    for (int i = 0; i < NPROC; i++)
+  for (p = proc; p < &proc[NPROC]; p++)
+  {
+    if (p->mlfqInfo.priority != 0)
     {
-      if (proc[i].state == RUNNABLE && proc[i].mlfqInfo.priority < highest_priority)
-      {
-        highest_priority = proc[i].mlfqInfo.priority;
-      }
+      p->mlfqInfo.ticksAtMaxPriority = 0;
+      mlfq_setpriority(&cpus[p->cpu].rq, p, 0);
     }
+  }
+}
 
-    // Collect processes with the highest priority
-    int num_procs_highest_priority = 0;              // Number of processes with the highest priority
-    struct proc *procs_with_highest_priority[NPROC]; // Array to store processes with the highest priority
+// Round-robin: one FIFO, and every tick ends the slice.
+
+static void
+rr_enqueue(struct runq *rq, struct proc *p, int flags)
+{
+  procq_append(&rq->rr, p);
+}
+
+static void
+rr_dequeue(struct runq *rq, struct proc *p)
+{
+  procq_remove(&rq->rr, p);
+}
+
+static struct proc *
+rr_pick_next(struct runq *rq)
+{
+  return rq->rr.head;
+}
+
+static struct proc *
+rr_pick_migrate(struct runq *rq)
+{
+  return rq->rr.tail;
+}
+
+static int
+rr_tick(struct runq *rq, struct proc *p)
+{
+  return 1;
+}
 
-    for (int i = 0; i < NPROC; i++)
+// MLFQ: a FIFO per level, with a bitmap of the non-empty ones.
+
+static void
+mlfq_enqueue(struct runq *rq, struct proc *p, int flags)
+{
+  int prio = p->mlfqInfo.priority;
+
+  if ((flags & ENQ_WAKEUP) && mlfqPolicy.demotion == MLFQ_DEMOTE_SLICE)
+    p->mlfqInfo.ticks[prio] = 0;
+
+  // preempted part way through its quantum: let it finish it
+  // ahead of the rest of its level.
+  if ((flags & ENQ_PREEMPT) && p->mlfqInfo.ticks[prio] > 0)
+    procq_push(&rq->mlfq[prio], p);
+  else
+    procq_append(&rq->mlfq[prio], p);
+  p->mlfqInfo.addedToMLFQ = 1;
+  rq->mlfqBitmap |= 1 << prio;
+}
+
+static void
+mlfq_dequeue(struct runq *rq, struct proc *p)
+{
+  int prio = p->mlfqInfo.priority;
+
+  procq_remove(&rq->mlfq[prio], p);
+  p->mlfqInfo.addedToMLFQ = 0;
+  if (rq->mlfq[prio].head == 0)
+    rq->mlfqBitmap &= ~(1 << prio);
+}
+
+// Picking the next process is a find-first-set on mlfqBitmap,
+// with no scan of proc[].
+static struct proc *
+mlfq_pick_next(struct runq *rq)
+{
+  if (rq->mlfqBitmap == 0)
+    return 0;
+  return rq->mlfq[ffs(rq->mlfqBitmap) - 1].head;
+}
+
+static struct proc *
+mlfq_pick_migrate(struct runq *rq)
+{
+  if (rq->mlfqBitmap == 0)
+    return 0;
+  return rq->mlfq[ffs(rq->mlfqBitmap) - 1].tail;
+}
+
+// Charge the tick to p's level. Preempt once p has used the
+// quantum of its level, or if a higher level has work waiting.
+static int
+mlfq_tick(struct runq *rq, struct proc *p)
+{
+  int prio;
+
+  mlfq_boost(rq);
+
+  prio = p->mlfqInfo.priority;
+  p->mlfqInfo.ticks[prio]++;
+  p->mlfqInfo.tickCounts[prio]++;
+
+  if (p->mlfqInfo.ticks[prio] >= mlfqPolicy.quantum[prio])
+  {
+    if (prio < mlfqParams.m - 1)
+      mlfq_setpriority(rq, p, prio + 1); // Move p to the next lower priority queue
+    else
+      p->mlfqInfo.ticks[prio] = 0; // It is in the lowest priority already
+    return 1;
+  }
+  return (rq->mlfqBitmap & ((1 << prio) - 1)) != 0;
+}
+
+static void
+mlfq_exit(struct runq *rq, struct proc *p)
+{
+  if (mlfq_at_bottom(p))
+    mlfq_age_remove(rq, p);
+  // so a global boost does not find it at the bottom level.
+  p->mlfqInfo.priority = 0;
+}
+
+static void
+mlfq_migrate(struct runq *from, struct runq *to, struct proc *p)
+{
+  if (mlfq_at_bottom(p))
+  {
+    mlfq_age_remove(from, p);
+    mlfq_age_insert(to, p);
+  }
+}
+
+// Everyone starts at the top queue.
+static void
+mlfq_start(void)
+{
+  struct proc *p;
+
+  for (p = proc; p < &proc[NPROC]; p++)
+  {
+    p->mlfqInfo.priority = 0;
+    for (int i = 0; i < MLFQ_MAX_LEVEL; i++)
+      p->mlfqInfo.ticks[i] = 0;
+  }
+  mlfqLastBoost = ticks;
+}
+
+// Forget the age lists; nothing is at the bottom any more.
+static void
+mlfq_stop(void)
+{
+  struct proc *p;
+  struct cpu *c;
+
+  for (c = cpus; c < &cpus[NCPU]; c++)
+  {
+    while (c->rq.mlfqBottom.head != 0)
+      mlfq_age_remove(&c->rq, c->rq.mlfqBottom.head);
+  }
+  for (p = proc; p < &proc[NPROC]; p++)
+    p->mlfqInfo.priority = 0;
+}
+
+// Runs the global boost of the MLFQ policy once every boostPeriod
+// ticks.
+static void
+mlfq_clock(void)
+{
+  if (mlfqPolicy.boostPeriod <= 0 ||
+      ticks - mlfqLastBoost < mlfqPolicy.boostPeriod)
+    return;
+
+  rq_lockall();
+  if (activeClass == &mlfqClass && mlfqPolicy.boostPeriod > 0 &&
+      ticks - mlfqLastBoost >= mlfqPolicy.boostPeriod)
+  {
+    mlfqLastBoost = ticks;
+    mlfq_boostall();
+  }
+  rq_unlockall();
+}
+
+// Stride: a heap ordered by pass, so a pick is O(log n).
+
+static void
+stride_enqueue(struct runq *rq, struct proc *p, int flags)
+{
+  // Don't let a process that slept bank the pass it missed.
+  if ((flags & ENQ_WAKEUP) && p->stridePass < rq->stridePass)
+    p->stridePass = rq->stridePass;
+  p->heapKey = p->stridePass;
+  procheap_insert(&rq->stride, p);
+}
+
+static void
+stride_dequeue(struct runq *rq, struct proc *p)
+{
+  procheap_remove(&rq->stride, p);
+}
+
+static struct proc *
+stride_pick_next(struct runq *rq)
+{
+  struct proc *p = procheap_min(&rq->stride);
+
+  if (p != 0)
+    rq->stridePass = p->stridePass;
+  return p;
+}
+
+static struct proc *
+stride_pick_migrate(struct runq *rq)
+{
+  if (rq->stride.n == 0)
+    return 0;
+  return rq->stride.procs[rq->stride.n - 1];
+}
+
+// Preempt once another process has a smaller pass.
+static int
+stride_tick(struct runq *rq, struct proc *p)
+{
+  struct proc *next;
+
+  p->stridePass += STRIDE1 / p->tickets;
+  next = procheap_min(&rq->stride);
+  return next != 0 && next->stridePass < p->stridePass;
+}
+
+// A child starts level with its parent, so forking does not
+// buy cpu time.
+static void
+stride_fork(struct proc *parent, struct proc *child)
+{
+  child->stridePass = parent->stridePass;
+}
+
+// Keep p's lead over the pass of its old queue on the new one.
+static void
+stride_migrate(struct runq *from, struct runq *to, struct proc *p)
+{
+  p->stridePass = p->stridePass - from->stridePass + to->stridePass;
+}
+
+// Every process starts from a pass of 0.
+static void
+stride_start(void)
+{
+  struct proc *p;
+  struct cpu *c;
+
+  for (p = proc; p < &proc[NPROC]; p++)
+    p->stridePass = 0;
+  for (c = cpus; c < &cpus[NCPU]; c++)
+    c->rq.stridePass = 0;
+}
+
+// CFS: a red-black tree ordered by vruntime, the ticks a process
+// has run scaled by the weight of its nice value. The process that
+// has had least cpu for its weight runs next.
+
+// Weight of each nice value from -20 to 19, as in Linux: one nice
+// level is about 10% more or less cpu.
+static const int cfsWeights[40] = {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */ 9548, 7620, 6100, 4904, 3906,
+    /*  -5 */ 3121, 2501, 1991, 1586, 1277,
+    /*   0 */ 1024, 820, 655, 526, 423,
+    /*   5 */ 335, 272, 215, 172, 137,
+    /*  10 */ 110, 87, 70, 56, 45,
+    /*  15 */ 36, 29, 23, 18, 15,
+};
+
+#define CFS_NICE0_WEIGHT 1024
+#define CFS_TICK (1 << 20)           // vruntime of one tick at nice 0
+#define CFS_GRANULARITY CFS_TICK     // lead the next process needs to preempt
+#define CFS_WAKEUP_CREDIT (3 * CFS_TICK) // how far behind a waking process may start
+
+#define cfs_proc(n) rb_entry(n, struct proc, cfsNode)
+
+static int
+cfs_less(struct rbnode *a, struct rbnode *b)
+{
+  return cfs_proc(a)->vruntime < cfs_proc(b)->vruntime;
+}
+
+// A process that slept starts a little behind the others, so
+// interactive jobs get the cpu quickly, but it cannot bank the
+// time it slept.
+static void
+cfs_enqueue(struct runq *rq, struct proc *p, int flags)
+{
+  if ((flags & ENQ_WAKEUP) && rq->cfsMinVruntime > CFS_WAKEUP_CREDIT &&
+      p->vruntime < rq->cfsMinVruntime - CFS_WAKEUP_CREDIT)
+    p->vruntime = rq->cfsMinVruntime - CFS_WAKEUP_CREDIT;
+  rb_insert(&rq->cfs, &p->cfsNode, cfs_less);
+}
+
+static void
+cfs_dequeue(struct runq *rq, struct proc *p)
+{
+  rb_erase(&rq->cfs, &p->cfsNode);
+}
+
+static struct proc *
+cfs_pick_next(struct runq *rq)
+{
+  struct rbnode *n = rb_first(&rq->cfs);
+
+  if (n == 0)
+    return 0;
+  if (cfs_proc(n)->vruntime > rq->cfsMinVruntime)
+    rq->cfsMinVruntime = cfs_proc(n)->vruntime;
+  return cfs_proc(n);
+}
+
+static struct proc *
+cfs_pick_migrate(struct runq *rq)
+{
+  struct rbnode *n = rb_last(&rq->cfs);
+
+  return n != 0 ? cfs_proc(n) : 0;
+}
+
+// Charge p a tick of vruntime, less the heavier it is. Preempt once
+// the leftmost process is more than CFS_GRANULARITY behind it.
+static int
+cfs_tick(struct runq *rq, struct proc *p)
+{
+  struct rbnode *n;
+  uint64 min;
+
+  p->vruntime += (uint64)CFS_TICK * CFS_NICE0_WEIGHT / cfsWeights[p->nice + 20];
+
+  min = p->vruntime;
+  n = rb_first(&rq->cfs);
+  if (n != 0 && cfs_proc(n)->vruntime < min)
+    min = cfs_proc(n)->vruntime;
+  if (min > rq->cfsMinVruntime)
+    rq->cfsMinVruntime = min;
+
+  return n != 0 && p->vruntime > cfs_proc(n)->vruntime + CFS_GRANULARITY;
+}
+
+// A child starts where its parent is, so forking does not buy cpu.
+static void
+cfs_fork(struct proc *parent, struct proc *child)
+{
+  child->vruntime = parent->vruntime;
+}
+
+// Keep p's place relative to the minimum vruntime of its queue.
+static void
+cfs_migrate(struct runq *from, struct runq *to, struct proc *p)
+{
+  long lag = (long)(p->vruntime - from->cfsMinVruntime);
+
+  if (lag < 0 && (uint64)-lag > to->cfsMinVruntime)
+    p->vruntime = 0;
+  else
+    p->vruntime = to->cfsMinVruntime + lag;
+}
+
+static void
+cfs_start(void)
+{
+  struct proc *p;
+  struct cpu *c;
+
+  for (p = proc; p < &proc[NPROC]; p++)
+    p->vruntime = 0;
+  for (c = cpus; c < &cpus[NCPU]; c++)
+    c->rq.cfsMinVruntime = 0;
+}
+
+static struct schedClass rrClass = {
+    .enqueue = rr_enqueue,
+    .dequeue = rr_dequeue,
+    .pick_next = rr_pick_next,
+    .pick_migrate = rr_pick_migrate,
+    .tick = rr_tick,
+};
+
+static struct schedClass mlfqClass = {
+    .enqueue = mlfq_enqueue,
+    .dequeue = mlfq_dequeue,
+    .pick_next = mlfq_pick_next,
+    .pick_migrate = mlfq_pick_migrate,
+    .tick = mlfq_tick,
+    .exit = mlfq_exit,
+    .migrate = mlfq_migrate,
+    .start = mlfq_start,
+    .stop = mlfq_stop,
+    .clock = mlfq_clock,
+};
+
+static struct schedClass strideClass = {
+    .enqueue = stride_enqueue,
+    .dequeue = stride_dequeue,
+    .pick_next = stride_pick_next,
+    .pick_migrate = stride_pick_migrate,
+    .tick = stride_tick,
+    .fork = stride_fork,
+    .migrate = stride_migrate,
+    .start = stride_start,
+};
+
+static struct schedClass cfsClass = {
+    .enqueue = cfs_enqueue,
+    .dequeue = cfs_dequeue,
+    .pick_next = cfs_pick_next,
+    .pick_migrate = cfs_pick_migrate,
+    .tick = cfs_tick,
+    .fork = cfs_fork,
+    .migrate = cfs_migrate,
+    .start = cfs_start,
+};
+
+// Scheduling classes by the policy number setScheduler() takes.
+static struct schedClass *schedClasses[] = {
+    [SCHED_RR] = &rrClass,
+    [SCHED_MLFQ] = &mlfqClass,
+    [SCHED_STRIDE] = &strideClass,
+    [SCHED_CFS] = &cfsClass,
+};
+
+// Make `to` the active class. Every queued process is taken off its
+// run queue by the old class and queued again, on the same cpu,
+// by the new one, most urgent first, so no queue is left holding
+// stale entries. Caller must hold every run queue lock.
+static void
+sched_switch(struct schedClass *to)
+{
+  struct procQueue moving[NCPU];
+  struct proc *p;
+  struct cpu *c;
+
+  if (to == activeClass)
+    return;
+
+  for (c = cpus; c < &cpus[NCPU]; c++)
+  {
+    moving[c - cpus].head = moving[c - cpus].tail = 0;
+    while ((p = activeClass->pick_next(&c->rq)) != 0)
     {
-      if (proc[i].state == RUNNABLE && proc[i].mlfqInfo.priority == highest_priority)
-      {
-        procs_with_highest_priority[num_procs_highest_priority++] = &proc[i];
-      }
+      rq_remove(&c->rq, p);
+      procq_append(&moving[c - cpus], p);
     }
+  }
 
-    // Debug: Print information about processes and their states
-    // printf("(In MLFQ_scheduler) Processes with highest priority. The highest priority is:  %d\n", highest_priority);
-    // for (int i = 0; i < num_procs_highest_priority; i++)
-    // {
-    //   printf("(In MLFQ_scheduler) Process %d, priority=%d\n", procs_with_highest_priority[i]->pid, procs_with_highest_priority[i]->mlfqInfo.priority);
-    // }
-    // If there are multiple processes with the highest priority, select based on Round-Robin
-    if (num_procs_highest_priority > 1)
-    {
-      // Find the next process to run in Round-Robin fashion
-      selected_proc = procs_with_highest_priority[rr_index];
-      rr_index = (rr_index + 1 ) % num_procs_highest_priority; // Move to the next process for the next time
+  if (activeClass->stop)
+    activeClass->stop();
+  activeClass = to;
+  if (activeClass->start)
+    activeClass->start();
 
-      //printf("(In MLFQ_scheduler) Multiple processes with highest priority. Selected process: pid=%d, priority=%d\n", selected_proc->pid, selected_proc->mlfqInfo.priority);
-    }
-    else if (num_procs_highest_priority == 1)
+  for (c = cpus; c < &cpus[NCPU]; c++)
+  {
+    while ((p = moving[c - cpus].head) != 0)
     {
-      selected_proc = procs_with_highest_priority[0]; // If only one process with the highest priority, select it
-      //printf("(In MLFQ_scheduler) There is only one process with the highest priority. Selected process: pid=%d, priority=%d\n", selected_proc->pid, selected_proc->mlfqInfo.priority);
+      procq_remove(&moving[c - cpus], p);
+      rq_add(&c->rq, p, 0);
     }
+  }
+}
+
+// Called on hart 0 after each clock tick, for policy-wide work.
+void sched_clock(void)
+{
+  struct schedClass *cl = activeClass;
+
+  if (cl->clock)
+    cl->clock();
+}
+
+// Charge p, running on this cpu, for the timer tick that just
+// arrived. Returns 1 if p should give up the cpu.
+int sched_tick(struct proc *p)
+{
+  struct runq *rq;
+  int preempt;
+
+  rq = rq_lock_proc(p);
+  dl_unthrottle(rq);
+  if (p->dlRuntime > 0)
+    preempt = dl_tick(rq, p);
+  else
+    preempt = activeClass->tick(rq, p) || rq->dl.n > 0;
+  release(&rq->lock);
+
+  return preempt;
+}
 
-    p = selected_proc; // Assign the selected process to p
+// Let the active class set up child, a new process forked from
+// parent, before it is first queued on cpu. A child placed on
+// another cpu than parent's moves there as a migration would, so
+// what it inherits (vruntime, pass) is rebased on the new queue.
+static void
+sched_fork(struct proc *parent, struct proc *child, int cpu)
+{
+  struct runq *from, *to = &cpus[cpu].rq;
+
+  for (;;)
+  {
+    from = &cpus[parent->cpu].rq;
+    if (from == to)
+      acquire(&to->lock);
+    else
+      rq_lock2(from, to);
+    if (from == &cpus[parent->cpu].rq)
+      break;
+    if (from == to)
+      release(&to->lock);
+    else
+      rq_unlock2(from, to);
   }
 
-    // Run the selected process
-    if (p > 0)
+  if (activeClass->fork)
+    activeClass->fork(parent, child);
+  if (from != to && activeClass->migrate)
+    activeClass->migrate(from, to, child);
+  child->cpu = cpu;
+
+  if (from == to)
+    release(&to->lock);
+  else
+    rq_unlock2(from, to);
+}
+
+// Move up to n processes from one cpu's run queue to another's.
+// Takes the process the active class would run last, which would
+// otherwise wait longest. Caller must hold both run queue locks.
+static void
+rq_migrate(struct runq *from, struct cpu *to, int n)
+{
+  struct proc *p;
+
+  while (n-- > 0 && (p = activeClass->pick_migrate(from)) != 0)
+  {
+    rq_remove(from, p);
+    if (activeClass->migrate)
+      activeClass->migrate(from, &to->rq, p);
+    p->cpu = to - cpus;
+    rq_add(&to->rq, p, 0);
+  }
+}
+
+// c has nothing to run: steal a process from the busiest cpu.
+static void
+rq_steal(struct cpu *c)
+{
+  struct cpu *busiest = rq_busiest(c);
+
+  if (busiest == 0)
+    return;
+  rq_lock2(&c->rq, &busiest->rq);
+  if (c->rq.nqueued == 0)
+    rq_migrate(&busiest->rq, c, 1);
+  rq_unlock2(&c->rq, &busiest->rq);
+}
+
+// Every BALANCE_INTERVAL ticks, pull half the difference in queue
+// length from the busiest cpu, so queues even out over time.
+static void
+rq_balance(struct cpu *c)
+{
+  struct cpu *busiest;
+
+  if (ticks - c->rq.lastBalance < BALANCE_INTERVAL)
+    return;
+  c->rq.lastBalance = ticks;
+
+  busiest = rq_busiest(c);
+  if (busiest == 0 || busiest->rq.nqueued - c->rq.nqueued < 2)
+    return;
+  rq_lock2(&c->rq, &busiest->rq);
+  rq_migrate(&busiest->rq, c, (busiest->rq.nqueued - c->rq.nqueued) / 2);
+  rq_unlock2(&c->rq, &busiest->rq);
+}
+
+// Nothing to run on c: sleep in wfi until an interrupt arrives,
+// e.g. the next timer tick or an ipi() from rq_kick(). Interrupts
+// stay off until after wfi, so one that arrives between the check
+// and the wfi is left pending and wfi returns at once.
+static void
+rq_idle(struct cpu *c)
+{
+  intr_off();
+  c->idle = 1;
+  __sync_synchronize();
+  if (c->rq.nqueued == 0)
+    wfi();
+  c->idle = 0;
+  intr_on();
+}
+
+// Count time t in the log2 histogram hist.
+static void
+lat_record(uint *hist, uint64 t)
+{
+  int i = 0;
+
+  while (t >>= 1)
+    i++;
+  if (i >= NLATBUCKET)
+    i = NLATBUCKET - 1;
+  hist[i]++;
+}
+
+// Run p, just taken off c's run queue, until it gives up the cpu.
+// If it was preempted rather than sleeping or exiting, queue it again.
+static void
+rq_run(struct cpu *c, struct proc *p)
+{
+  struct runq *rq;
+
+  acquire(&p->lock);
+  if (p->state == RUNNABLE)
+  {
+    // Switch to chosen process. It is the process's job
+    // to release its lock and then reacquire it
+    // before jumping back to us.
+    p->state = RUNNING;
+    c->proc = p;
+    p->ranAt = r_time();
+    lat_record(p->lat.wait, p->ranAt - p->queuedAt);
+    if (p->wokenAt != 0)
+      lat_record(p->lat.wakeup, p->ranAt - p->wokenAt);
+    TRACE(TR_SWTCH, p->pid, p->ranAt - p->queuedAt);
+    swtch(&c->context, &p->context);
+    // Process is done running for now.
+    // It should have changed its p->state before coming back.
+    c->proc = 0;
+    lat_record(p->lat.slice, r_time() - p->ranAt);
+
+    if (p->state == RUNNABLE)
     {
-      acquire(&p->lock);
-      p->state = RUNNING;
-      c->proc = p;
-      swtch(&c->context, &p->context);
-      c->proc = 0;
-      release(&p->lock);
+      rq = rq_lock_proc(p);
+      rq_add(rq, p, ENQ_PREEMPT);
+      release(&rq->lock);
     }
   }
+  release(&p->lock);
+}
+
+// Per-CPU process scheduler.
+// Each CPU calls scheduler() after setting itself up.
+// Scheduler never returns.  It loops, doing:
+//  - choose a process to run.
+//  - swtch to start running that process.
+//  - eventually that process transfers control
+//    via swtch back to the scheduler.
+// Which process runs next is up to the active scheduling class.
+void scheduler(void)
+{
+  struct cpu *c = mycpu();
+  struct proc *p;
+
+  c->proc = 0;
+  c->online = 1;
+  for (;;)
+  {
+    // Avoid deadlock by ensuring that devices can interrupt.
+    intr_on();
+
+    rq_balance(c);
+    if (c->rq.nqueued == 0)
+      rq_steal(c);
+
+    acquire(&c->rq.lock);
+    dl_unthrottle(&c->rq);
+    if ((p = procheap_min(&c->rq.dl)) == 0)
+      p = activeClass->pick_next(&c->rq);
+    if (p != 0)
+      rq_remove(&c->rq, p);
+    release(&c->rq.lock);
+
+    if (p != 0)
+      rq_run(c, p);
+    else
+      rq_idle(c);
+  }
 }
 
     // System call to start MLFQ scheduler
@@ -803,25 +2026,23 @@ if(p == 0){
 
       argint(1, &n);
 
-      //printf("The value of m is: %d\n", m);
-      // Check if MLFQ scheduler is already running
-      if (mlfqFlag)
+      if (m < 1 || m > MLFQ_MAX_LEVEL)
+        return -1;
+
+      rq_lockall();
+      // MLFQ can only be started from round-robin
+      if (activeClass != &rrClass)
       {
-        //printf("(startMLFQ) MLFQ scheduler is already running\n");
-        return -1; // MLFQ scheduler is already running
+        rq_unlockall();
+        return -1; // MLFQ or another scheduler is already running
       }
 
       // Initialize MLFQ scheduler parameters
-      mlfqFlag = 1;     // Set MLFQ scheduler flag to indicate it is running
       mlfqParams.m = m; // number of priority levels
       mlfqParams.n = n; // maximum ticks at priority m-1 before boosting to 0
 
-      //printf("(startMLFQ) MLFQ scheduler started with m = %d, n = %d\n", m, n);
-
-      for (int i = 0; i < MLFQ_MAX_LEVEL; i++)
-      {
-        mlfqQueues[i].head = 0; // Initialize head pointer to NULL for each queue
-      }
+      sched_switch(&mlfqClass);
+      rq_unlockall();
 
       return 0; // Success
     }
@@ -829,14 +2050,17 @@ if(p == 0){
     // System call to stop MLFQ scheduler
     int stopMLFQ()
     {
+      rq_lockall();
       // Check if MLFQ scheduler is not running
-      if (!mlfqFlag)
+      if (activeClass != &mlfqClass)
       {
-        //printf("(stopMLFQ) MLFQ scheduler is not running\n");
+        rq_unlockall();
         return -1; // MLFQ scheduler is not running
       }
-      // Stop MLFQ scheduler
-      mlfqFlag = 0; // Clear MLFQ scheduler flag to indicate it is stopped
+
+      // Hand the queued processes back to round-robin
+      sched_switch(&rrClass);
+      rq_unlockall();
 
       return 0; // Success
     }
@@ -844,21 +2068,190 @@ if(p == 0){
     int getMLFQInfo(void)
     {
       uint64 arg_addr;
+      struct proc *p = myproc();
+      struct MLFQInfoReport report;
+      struct runq *rq;
 
       // Retrieve the pointer-type argument using argaddr()
       argaddr(0, &arg_addr);
 
+      rq = rq_lock_proc(p);
+      if (mlfq_at_bottom(p))
+        p->mlfqInfo.ticksAtMaxPriority = ticks - p->mlfqBottomSince;
+      report = p->mlfqInfo;
+      release(&rq->lock);
+
       // Copy the updated MLFQInfoReport structure back to user space
-      if (copyout(myproc()->pagetable, arg_addr, (char *)&(myproc()->mlfqInfo), sizeof(struct MLFQInfoReport)) < 0)
+      if (copyout(p->pagetable, arg_addr, (char *)&report, sizeof(struct MLFQInfoReport)) < 0)
       {
-        //printf("(getMLFQInfo) Failed to copy updated report structure to user space\n");
         return -1;
       }
 
-     //printf("(getMLFQInfo) Successfully updated and copied report structure to user space\n");
       return 0; // Success
     }
 
+    // System call to replace the MLFQ policy: the quantum of each
+    // level, the global boost period and how quanta are used up.
+    // Takes effect at the next tick, whether or not MLFQ is running.
+    int setMLFQPolicy(void)
+    {
+      uint64 arg_addr;
+      struct MLFQPolicy policy;
+
+      argaddr(0, &arg_addr);
+      if (copyin(myproc()->pagetable, (char *)&policy, arg_addr, sizeof(policy)) < 0)
+        return -1;
+
+      for (int i = 0; i < MLFQ_MAX_LEVEL; i++)
+        if (policy.quantum[i] < 1)
+          return -1;
+      if (policy.boostPeriod < 0)
+        return -1;
+      if (policy.demotion != MLFQ_DEMOTE_ALLOTMENT && policy.demotion != MLFQ_DEMOTE_SLICE)
+        return -1;
+
+      rq_lockall();
+      mlfqPolicy = policy;
+      mlfqLastBoost = ticks;
+      rq_unlockall();
+
+      return 0; // Success
+    }
+
+    // System call to switch from round-robin to stride scheduling.
+    int startStride(void)
+    {
+      rq_lockall();
+      if (activeClass != &rrClass)
+      {
+        rq_unlockall();
+        return -1;
+      }
+      sched_switch(&strideClass);
+      rq_unlockall();
+
+      return 0;
+    }
+
+    // System call to go back to round-robin from stride scheduling.
+    int stopStride(void)
+    {
+      rq_lockall();
+      if (activeClass != &strideClass)
+      {
+        rq_unlockall();
+        return -1;
+      }
+      sched_switch(&rrClass);
+      rq_unlockall();
+
+      return 0;
+    }
+
+    // System call to switch to any scheduling policy (SCHED_RR,
+    // SCHED_MLFQ, SCHED_STRIDE, SCHED_CFS), moving every runnable
+    // process over to it. Returns the policy that was in use.
+    int setScheduler(void)
+    {
+      int policy, old;
+
+      argint(0, &policy);
+      if (policy < 0 || policy >= NELEM(schedClasses))
+        return -1;
+
+      rq_lockall();
+      for (old = 0; schedClasses[old] != activeClass; old++)
+        ;
+      sched_switch(schedClasses[policy]);
+      rq_unlockall();
+
+      return old;
+    }
+
+    // System call to make the calling process a deadline process:
+    // every period ticks it is guaranteed runtime ticks of cpu
+    // before deadline ticks have passed, and is held to that budget.
+    // All zero makes it an ordinary process again. Fails if the
+    // deadline processes would reserve more than DL_BW_MAX of a cpu.
+    int sched_setdeadline(void)
+    {
+      int runtime, period, deadline;
+      uint64 bw = 0;
+      struct proc *p = myproc();
+      struct runq *rq;
+
+      argint(0, &runtime);
+      argint(1, &period);
+      argint(2, &deadline);
+
+      if (runtime != 0 || period != 0 || deadline != 0)
+      {
+        if (runtime < 1 || runtime > deadline || deadline > period)
+          return -1;
+        bw = ((uint64)runtime << DL_BW_SHIFT) / deadline;
+      }
+
+      // Admission control.
+      acquire(&dl_lock);
+      if (dlTotalBw - p->dlBw + bw > DL_BW_MAX)
+      {
+        release(&dl_lock);
+        return -1;
+      }
+      dlTotalBw = dlTotalBw - p->dlBw + bw;
+      p->dlBw = bw;
+      release(&dl_lock);
+
+      // p is running, so on no queue: it is safe to change class.
+      rq = rq_lock_proc(p);
+      p->dlRuntime = runtime;
+      p->dlPeriod = period;
+      p->dlDeadline = deadline;
+      dl_newperiod(p, ticks);
+      release(&rq->lock);
+
+      return 0;
+    }
+
+    // System call to set the calling process's nice value, from -20
+    // to 19, which weights its share of the cpu under CFS. Children
+    // inherit it.
+    int setNice(void)
+    {
+      int n;
+      struct proc *p = myproc();
+      struct runq *rq;
+
+      argint(0, &n);
+      if (n < -20 || n > 19)
+        return -1;
+
+      rq = rq_lock_proc(p);
+      p->nice = n;
+      release(&rq->lock);
+
+      return 0;
+    }
+
+    // System call to set the calling process's tickets, its share
+    // of the cpu under stride scheduling. Children inherit them.
+    int setTickets(void)
+    {
+      int n;
+      struct proc *p = myproc();
+      struct runq *rq;
+
+      argint(0, &n);
+      if (n < 1 || n > STRIDE_MAX_TICKETS)
+        return -1;
+
+      rq = rq_lock_proc(p);
+      p->tickets = n;
+      release(&rq->lock);
+
+      return 0;
+    }
+
     // Switch to scheduler.  Must hold only p->lock
     // and have changed proc->state. Saves and restores
     // intena because intena is a property of this
@@ -880,6 +2273,7 @@ if(p == 0){
       if (intr_get())
         panic("sched interruptible");
 
+      TRACE(TR_SCHED, p->state, 0);
       intena = mycpu()->intena;
       swtch(&p->context, &mycpu()->context);
       mycpu()->intena = intena;
@@ -916,19 +2310,62 @@ if(p == 0){
       usertrapret();
     }
 
-    // Atomically release lock and sleep on chan.
-    // Reacquires lock when awakened.
-    void sleep(void *chan, struct spinlock *lk)
+    // The wait queue for chan. Multiplicative hashing, since
+    // channels are often neighbouring fields like pi->nread and
+    // pi->nwrite.
+    static struct waitq *
+    waitq_of(void *chan)
+    {
+      return &waitqs[((uint64)chan * 0x9E3779B97F4A7C15ULL) >> (64 - WAITQ_SHIFT)];
+    }
+
+    // Add p to the tail of wq. Caller must hold wq->lock.
+    static void
+    waitq_append(struct waitq *wq, struct proc *p)
+    {
+      p->waitq = wq;
+      p->wqNext = 0;
+      p->wqPrev = wq->tail;
+      if (wq->tail != 0)
+        wq->tail->wqNext = p;
+      else
+        wq->head = p;
+      wq->tail = p;
+    }
+
+    // Take p off wq. Caller must hold wq->lock.
+    static void
+    waitq_remove(struct waitq *wq, struct proc *p)
+    {
+      if (p->wqPrev != 0)
+        p->wqPrev->wqNext = p->wqNext;
+      else
+        wq->head = p->wqNext;
+      if (p->wqNext != 0)
+        p->wqNext->wqPrev = p->wqPrev;
+      else
+        wq->tail = p->wqPrev;
+      p->wqNext = 0;
+      p->wqPrev = 0;
+      p->waitq = 0;
+    }
+
+    // Atomically release lock and sleep on chan, as an exclusive
+    // waiter if excl is set. Reacquires lock when awakened.
+    static void
+    sleep_common(void *chan, struct spinlock *lk, int excl)
     {
       struct proc *p = myproc();
+      struct waitq *wq = waitq_of(chan);
 
       // Must acquire p->lock in order to
       // change p->state and then call sched.
-      // Once we hold p->lock, we can be
+      // Once we hold wq->lock and p->lock, we can be
       // guaranteed that we won't miss any wakeup
-      // (wakeup locks p->lock),
+      // (wakeup locks both),
       // so it's okay to release lk.
 
+      acquire(&wq->lock);
       acquire(&p->lock); // DOC: sleeplock1
       release(lk);
 
@@ -938,35 +2375,98 @@ if(p == 0){
       // Go to sleep.
       p->chan = chan;
       p->state = SLEEPING;
+      p->wqExclusive = excl;
+      waitq_append(wq, p);
+      release(&wq->lock);
+      TRACE(TR_SLEEP, chan, excl);
 
       sched();
 
       // Tidy up.
       p->chan = 0;
+      release(&p->lock);
+
+      // wakeup() takes p off the wait queue, but kill() leaves it
+      // there, since it holds p->lock and can't lock the queue.
+      if (p->waitq != 0)
+      {
+        acquire(&wq->lock);
+        waitq_remove(wq, p);
+        release(&wq->lock);
+      }
 
       // Reacquire original lock.
-      release(&p->lock);
       acquire(lk);
     }
 
-    // Wake up all processes sleeping on chan.
-    // Must be called without any p->lock.
-    void wakeup(void *chan)
+    // Atomically release lock and sleep on chan.
+    // Reacquires lock when awakened.
+    void sleep(void *chan, struct spinlock *lk)
     {
-      struct proc *p;
+      sleep_common(chan, lk, 0);
+    }
 
-      for (p = proc; p < &proc[NPROC]; p++)
+    // Like sleep(), but wakeup_one() wakes only one exclusive
+    // sleeper at a time. Whoever is woken must pass the wakeup
+    // on with wakeup_one() if it leaves work for the others, or
+    // gives up (e.g. because it was killed).
+    void sleep_exclusive(void *chan, struct spinlock *lk)
+    {
+      sleep_common(chan, lk, 1);
+    }
+
+    // Wake up every ordinary sleeper on chan and at most nexcl
+    // exclusive ones, longest waiting first (all if nexcl < 0).
+    // Returns the number of processes woken.
+    static int
+    wakeup_common(void *chan, int nexcl)
+    {
+      struct waitq *wq = waitq_of(chan);
+      struct proc *p, *next;
+      int n = 0;
+
+      acquire(&wq->lock);
+      for (p = wq->head; p != 0; p = next)
       {
-        if (p != myproc())
+        next = p->wqNext;
+        acquire(&p->lock);
+        if (p->state == SLEEPING && p->chan == chan &&
+            (!p->wqExclusive || nexcl != 0))
         {
-          acquire(&p->lock);
-          if (p->state == SLEEPING && p->chan == chan)
-          {
-            p->state = RUNNABLE;
-          }
-          release(&p->lock);
+          if (p->wqExclusive && nexcl > 0)
+            nexcl--;
+          waitq_remove(wq, p);
+          setrunnable(p);
+          TRACE(TR_WAKEUP, chan, p->pid);
+          n++;
         }
+        release(&p->lock);
       }
+      release(&wq->lock);
+      return n;
+    }
+
+    // Wake up all processes sleeping on chan.
+    // Must be called without any p->lock.
+    void wakeup(void *chan)
+    {
+      wakeup_common(chan, -1);
+    }
+
+    // Wake up the ordinary sleepers on chan, but only one of the
+    // sleep_exclusive() ones, to avoid a thundering herd.
+    // Must be called without any p->lock.
+    void wakeup_one(void *chan)
+    {
+      wakeup_common(chan, 1);
+    }
+
+    // Wake up the ordinary sleepers on chan and at most n of the
+    // sleep_exclusive() ones (all if n < 0). Returns the number
+    // of processes woken.
+    int wakeup_n(void *chan, int n)
+    {
+      return wakeup_common(chan, n);
     }
 
     // Kill the process with the given pid.
@@ -985,7 +2485,7 @@ if(p == 0){
           if (p->state == SLEEPING)
           {
             // Wake process from sleep().
-            p->state = RUNNABLE;
+            setrunnable(p);
           }
           release(&p->lock);
           return 0;
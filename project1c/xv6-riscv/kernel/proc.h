@@ -19,6 +19,88 @@ struct context
   uint64 s11;
 };
 
+// Define the max level
+#define MLFQ_MAX_LEVEL 10
+
+// Intrusive FIFO of processes threaded through struct proc,
+// so run queue operations never allocate.
+struct procQueue {
+    struct proc *head; // Head (next to run) of the queue
+    struct proc *tail; // Tail of the queue
+};
+
+// Binary min-heap of processes ordered by heapKey, for policies
+// that always run the process with the smallest key.
+struct procHeap {
+    struct proc *procs[NPROC]; // procs[0] has the smallest key
+    int n;                     // Number of processes in the heap
+};
+
+// Stride scheduling: each tick a process runs adds STRIDE1/tickets
+// to its pass, and the process with the smallest pass runs next.
+#define STRIDE1 (1 << 20)
+#define STRIDE_DEFAULT_TICKETS 100
+#define STRIDE_MAX_TICKETS 10000
+
+// Deadline processes may reserve at most 90% of one cpu between
+// them, as the sum of runtime/deadline, so they stay schedulable even
+// if all end up on one cpu, and cannot starve everyone else.
+#define DL_BW_SHIFT 20
+#define DL_BW_MAX ((90 << DL_BW_SHIFT) / 100)
+
+// Per-CPU run queue. A CPU schedules from its own run queue and only
+// touches another CPU's to steal work or balance load.
+struct runq
+{
+  struct spinlock lock;
+  struct procQueue rr;                   // RUNNABLE processes when round-robin
+  struct procQueue mlfq[MLFQ_MAX_LEVEL]; // RUNNABLE processes at each MLFQ level
+  uint mlfqBitmap;                       // Bit i is set iff mlfq[i] is non-empty
+  struct procQueue mlfqBottom;           // Processes at level m-1, oldest arrival first
+  struct procHeap stride;                // RUNNABLE processes when stride, by pass
+  uint64 stridePass;                     // Pass of the process last picked to run
+  struct rbtree cfs;                     // RUNNABLE processes when CFS, by vruntime
+  uint64 cfsMinVruntime;                 // Floor for the vruntime of processes waking up
+  struct procHeap dl;                    // Deadline processes, by absolute deadline
+  struct procQueue dlThrottled;          // Deadline processes out of budget
+  int nqueued;                           // Number of processes ready to run
+  uint lastBalance;                      // ticks at the last load balancing pass
+};
+
+// Scheduling policies, for setScheduler().
+#define SCHED_RR     0
+#define SCHED_MLFQ   1
+#define SCHED_STRIDE 2
+#define SCHED_CFS    3
+
+// Why a process is being put on a run queue.
+#define ENQ_WAKEUP  1 // it just became runnable
+#define ENQ_PREEMPT 2 // it was running and got preempted
+
+// A scheduling policy. One class is active at a time and owns the
+// order of every run queue; the rest of the kernel only calls these
+// hooks, with the run queue they act on locked unless noted. fork
+// is called with child->lock, the parent's run queue lock and, when
+// the child goes to another cpu, that cpu's too; migrate with both
+// from and to locked. So no hook but clock may take a run queue
+// lock.
+struct schedClass
+{
+  void (*enqueue)(struct runq *rq, struct proc *p, int flags); // Queue RUNNABLE p
+  void (*dequeue)(struct runq *rq, struct proc *p);            // Unqueue p
+  struct proc *(*pick_next)(struct runq *rq);                  // Process to run next, or 0
+  struct proc *(*pick_migrate)(struct runq *rq);               // Queued process to move away, or 0
+  int (*tick)(struct runq *rq, struct proc *p);                // Charge running p a tick; 1 to preempt
+
+  // Optional hooks, 0 if unused:
+  void (*fork)(struct proc *parent, struct proc *child);       // Set up child before it is queued; see above
+  void (*exit)(struct runq *rq, struct proc *p);               // p is being freed
+  void (*migrate)(struct runq *from, struct runq *to, struct proc *p); // p moves to another cpu
+  void (*start)(void);                                         // Becoming active, all run queues locked
+  void (*stop)(void);                                          // No longer active, all run queues locked
+  void (*clock)(void);                                         // Hart 0 took a clock tick, no locks held
+};
+
 // Per-CPU state.
 struct cpu
 {
@@ -26,6 +108,9 @@ struct cpu
   struct context context; // swtch() here to enter scheduler().
   int noff;               // Depth of push_off() nesting.
   int intena;             // Were interrupts enabled before push_off()?
+  struct runq rq;         // Processes waiting to run on this cpu.
+  int online;             // Has this cpu entered scheduler()?
+  int idle;               // Is this cpu waiting in wfi for work?
 
   int runCount;        // number of times that the process has been scheduled to run on CPU
   int systemcallCount; // no. Of times that the process has made system calls
@@ -99,13 +184,6 @@ enum procstate
   ZOMBIE
 };
 
-// MLFQ scheduler functions
-void MLFQ_scheduler(struct cpu *c);
-void RR_scheduler(struct cpu *c);
-
-// Define the max level
-#define MLFQ_MAX_LEVEL 10
-
 // Struct to hold MLFQ process information
 struct MLFQInfoReport {
     int addedToMLFQ;                    // Flag indicating if process is added to MLFQ queue
@@ -115,30 +193,60 @@ struct MLFQInfoReport {
     int tickCounts[MLFQ_MAX_LEVEL];     // Add tickCounts member...didn't seem to use this
 };
 
+// How a process uses up the quantum of its level.
+#define MLFQ_DEMOTE_ALLOTMENT 0 // ticks add up across sleeps until demotion
+#define MLFQ_DEMOTE_SLICE     1 // ticks start over each time it becomes runnable
+
+// Tunable MLFQ policy, set with setMLFQPolicy().
+struct MLFQPolicy {
+    int quantum[MLFQ_MAX_LEVEL];        // Ticks a process may run at each level before demotion
+    int boostPeriod;                    // Ticks between boosts of every process to level 0, 0 for never
+    int demotion;                       // MLFQ_DEMOTE_ALLOTMENT or MLFQ_DEMOTE_SLICE
+};
+
 // Declare system call prototypes
 int startMLFQ();
 int stopMLFQ();
 int getMLFQInfo();
+int setMLFQPolicy();
+int startStride();
+int stopStride();
+int setTickets();
+int setScheduler();
+int sched_setdeadline();
+int setNice();
+
 
 
-extern int mlfqFlag; // Declare the flag
+void setrunnable(struct proc *p);
 
-// MLFQ queue element
-struct mlfqQueueElement {
-    struct proc *proc; // Pointer to process
-    struct mlfqQueueElement *next; // Pointer to next element
-    struct mlfqQueueElement *prev; // Pointer to previous element
+// Processes sleeping on channels that hash to the same bucket,
+// so wakeup(chan) only looks at processes that might be on chan.
+struct waitq
+{
+  struct spinlock lock;
+  struct proc *head; // Sleepers, linked through wqNext/wqPrev
+  struct proc *tail;
 };
 
-// MLFQ queue structure
-struct mlfqQueue {
-    struct mlfqQueueElement *head; // Head element of the queue
+// log2 histograms of scheduling latencies, in r_time() units.
+// Bucket i counts times from 2^i to 2^(i+1)-1; bucket 0 also
+// counts 0, and the last bucket everything larger.
+#define NLATBUCKET 32
+struct schedLatency {
+    uint wait[NLATBUCKET];   // Queued to run until running
+    uint slice[NLATBUCKET];  // Running until giving up the cpu
+    uint wakeup[NLATBUCKET]; // Woken from sleep until running
 };
 
-// Function declarations
-void mlfq_enque(struct mlfqQueue *queue, struct proc *proc);
-struct proc *mlfq_deque(struct mlfqQueue *queue);
-void mlfq_delete(struct mlfqQueue *queue, struct proc *proc);
+// The user memory of a process and the threads clone() made,
+// which share its page table. A process gets one at its first
+// clone() and keeps it until exec() or exit.
+struct vmshare
+{
+  struct spinlock lock; // Serializes changes to the page table and sz
+  int nproc;            // Procs using the page table
+};
 
 // Per-process state
 struct proc
@@ -152,18 +260,26 @@ struct proc
   int xstate;           // Exit status to be returned to parent's wait
   int pid;              // Process ID
 
-  // wait_lock must be held when using this:
+  // wait_lock must be held when using these:
   struct proc *parent; // Parent process
+  int isthread;        // Made by clone(), so reaped by join() rather than wait()
 
   // these are private to the process, so p->lock need not be held.
   uint64 kstack;               // Virtual address of kernel stack
   uint64 sz;                   // Size of process memory (bytes)
-  pagetable_t pagetable;       // User page table
+  pagetable_t pagetable;       // User page table, maybe shared with threads
   struct trapframe *trapframe; // data page for trampoline.S
+  uint64 tfva;                 // User address trapframe is mapped at
+  struct vmshare *vmshare;     // Shared with threads, or 0 if never shared
   struct context context;      // swtch() here to run process
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
+  int alarmInterval;           // Ticks of cpu between sigalarm() upcalls, 0 for none
+  uint64 alarmHandler;         // User address of the upcall handler
+  int alarmTicks;              // Ticks left until the next upcall
+  int alarmActive;             // In the handler, until it calls sigreturn()
+  struct trapframe alarmFrame; // Registers to restore at sigreturn()
 
 
 
@@ -177,5 +293,42 @@ struct proc
 
   //Added the MLFQ
   struct MLFQInfoReport mlfqInfo;
+
+  // p->lock must be held when using these:
+  struct schedLatency lat; // Scheduling latency histograms
+  uint64 queuedAt;         // r_time() when last queued to run
+  uint64 wokenAt;          // r_time() when last woken, or 0 if it was preempted
+  uint64 ranAt;            // r_time() when last switched to
+
+  // cpus[cpu].rq.lock must be held when using these,
+  // and when changing mlfqInfo.priority or mlfqInfo.ticks:
+  int cpu;                  // Cpu whose run queue holds (or last held) the process
+  int onrq;                 // Is the process on that run queue?
+  struct proc *qNext;       // Next process in its run queue list
+  struct proc *qPrev;       // Previous process in its run queue list
+  struct proc *mlfqAgeNext; // Next process on the bottom-level age list
+  struct proc *mlfqAgePrev; // Previous process on the bottom-level age list
+  uint mlfqBottomSince;      // ticks when the process reached level m-1
+  uint64 heapKey;           // Sort key while in a run queue heap
+  int heapIdx;              // Index in that heap
+  int tickets;              // Share of the cpu under stride scheduling
+  uint64 stridePass;        // Virtual time used under stride scheduling
+  struct rbnode cfsNode;    // Node in the CFS tree of the run queue
+  uint64 vruntime;          // Weighted ticks run, under CFS
+  int nice;                 // -20 (most cpu) to 19 (least); sets the CFS weight
+  int dlRuntime;            // Ticks of cpu per period, 0 if not a deadline process
+  int dlPeriod;             // Ticks between the starts of periods
+  int dlDeadline;           // Ticks after the start of a period to get dlRuntime by
+  int dlBudget;             // Ticks of dlRuntime left in this period
+  uint dlAbsDeadline;       // ticks by which this period's budget is due
+  uint dlPeriodEnd;         // ticks when the next period starts
+  int dlThrottled;          // Out of budget, waiting on dlThrottled?
+  uint64 dlBw;              // Share of a cpu reserved; dl_lock protects it
+
+  // waitq->lock must be held when using these:
+  struct waitq *waitq;      // Wait queue the process is on, or 0
+  struct proc *wqNext;      // Next sleeper in the wait queue
+  struct proc *wqPrev;      // Previous sleeper in the wait queue
+  int wqExclusive;          // Woken one at a time by wakeup_one()?
 };
 
@@ -0,0 +1,173 @@
+// Sampling profiler.
+//
+// While enabled, every timer interrupt on every hart records the
+// pc it interrupted, user or kernel, along with the return
+// addresses found by following the frame-pointer chain, into that
+// hart's ring of samples. profread() drains the rings; the user
+// prof program turns them into profiles.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rbtree.h"
+#include "proc.h"
+#include "prof.h"
+#include "defs.h"
+
+struct profring {
+  struct spinlock lock;
+  struct profsample buf[PROF_NSAMPLE];
+  uint head;     // samples written
+  uint tail;     // samples read
+  uint dropped;  // samples overwritten before being read
+};
+
+static struct profring rings[NCPU];
+static volatile int profon;
+
+void
+profinit(void)
+{
+  for(int i = 0; i < NCPU; i++)
+    initlock(&rings[i].lock, "prof");
+}
+
+// read the frame record below user fp (saved fp, then ra)
+// without faulting anything in.
+static int
+prof_userframe(pagetable_t pagetable, uint64 fp, uint64 frame[2])
+{
+  uint64 va, pa;
+
+  va = fp - 16;
+  if(fp < 16 || (va & 15) != 0)
+    return -1;
+  if((pa = walkaddr(pagetable, PGROUNDDOWN(va))) == 0)
+    return -1;
+  memmove(frame, (void*)(pa + (va - PGROUNDDOWN(va))), 16);
+  return 0;
+}
+
+// is the kernel stack page at lo one we can safely read?
+// interrupted kernel code runs on p's kernel stack, or on a
+// boot stack inside the kernel image.
+static int
+prof_kstackok(struct proc *p, uint64 lo)
+{
+  if(p != 0 && lo == p->kstack)
+    return 1;
+  return lo >= KERNBASE && lo + PGSIZE <= PHYSTOP;
+}
+
+// called on a timer interrupt with interrupts off. pc and fp are
+// the interrupted pc and frame pointer; user says whether they
+// belong to p's user address space.
+void
+profsample(struct proc *p, int user, uint64 pc, uint64 fp)
+{
+  struct profring *r;
+  struct profsample *s;
+  uint64 frame[2], lo;
+
+  if(!profon)
+    return;
+
+  r = &rings[cpuid()];
+  acquire(&r->lock);
+  if(r->head - r->tail == PROF_NSAMPLE){
+    r->tail++;
+    r->dropped++;
+  }
+  s = &r->buf[r->head++ % PROF_NSAMPLE];
+  s->pc = pc;
+  s->pid = p ? p->pid : 0;
+  s->user = user;
+  s->hart = cpuid();
+  s->depth = 0;
+
+  // a frame's record lives just below its fp; callers' frames are
+  // at higher addresses, so stop as soon as the chain goes down.
+  lo = PGROUNDDOWN(fp - 1);
+  while(s->depth < PROF_DEPTH){
+    if(user){
+      if(prof_userframe(p->pagetable, fp, frame) < 0)
+        break;
+    } else {
+      if((fp & 15) != 0 || fp - 16 < lo || fp > lo + PGSIZE ||
+         !prof_kstackok(p, lo))
+        break;
+      memmove(frame, (void*)(fp - 16), 16);
+    }
+    if(frame[1] == 0)
+      break;
+    s->chain[s->depth++] = frame[1];
+    if(frame[0] <= fp)
+      break;
+    fp = frame[0];
+  }
+  release(&r->lock);
+}
+
+// profctl(on): start (discarding old samples) or stop sampling.
+// returns whether sampling was on before.
+uint64
+sys_profctl(void)
+{
+  int on, old, i;
+
+  argint(0, &on);
+  old = profon;
+  if(on && !old){
+    for(i = 0; i < NCPU; i++){
+      acquire(&rings[i].lock);
+      rings[i].head = rings[i].tail = rings[i].dropped = 0;
+      release(&rings[i].lock);
+    }
+  }
+  profon = on != 0;
+  return old;
+}
+
+// profread(buf, n, dropped): copy up to n buffered samples, oldest
+// first within each hart, to buf. if dropped is not 0, store the
+// number of samples lost to ring overflow since the last read.
+// returns the number of samples copied.
+uint64
+sys_profread(void)
+{
+  uint64 buf, dst;
+  int n, got, i;
+  uint dropped;
+  struct profring *r;
+  struct profsample s;
+  struct proc *p = myproc();
+
+  argaddr(0, &buf);
+  argint(1, &n);
+  argaddr(2, &dst);
+
+  got = 0;
+  dropped = 0;
+  for(i = 0; i < NCPU; i++){
+    r = &rings[i];
+    for(;;){
+      acquire(&r->lock);
+      if(got == n || r->tail == r->head){
+        dropped += r->dropped;
+        r->dropped = 0;
+        release(&r->lock);
+        break;
+      }
+      s = r->buf[r->tail++ % PROF_NSAMPLE];
+      release(&r->lock);
+      if(copyout(p->pagetable, buf + got * sizeof(s), (char*)&s, sizeof(s)) < 0)
+        return -1;
+      got++;
+    }
+  }
+  if(dst != 0 && copyout(p->pagetable, dst, (char*)&dropped, sizeof(dropped)) < 0)
+    return -1;
+  return got;
+}
@@ -0,0 +1,12 @@
+// A sample taken by the profiler on a timer interrupt.
+#define PROF_DEPTH   8     // return addresses kept per sample
+#define PROF_NSAMPLE 512   // samples buffered per hart
+
+struct profsample {
+  uint64 pc;                // interrupted pc
+  uint64 chain[PROF_DEPTH]; // return addresses, innermost first
+  int depth;                // valid entries in chain
+  int pid;                  // interrupted process, 0 if none
+  int user;                 // was pc a user address?
+  int hart;                 // hart that took the sample
+};
@@ -0,0 +1,287 @@
+// Red-black tree, used to keep run queues ordered.
+//
+// The tree does not allocate: callers embed a struct rbnode in
+// their own objects and pass a less() function that orders two
+// nodes. Equal keys go to the right, so they come out in the order
+// they went in. Callers do their own locking.
+
+#include "types.h"
+#include "riscv.h"
+#include "rbtree.h"
+#include "defs.h"
+
+static void
+rb_rotate_left(struct rbtree *t, struct rbnode *x)
+{
+  struct rbnode *y = x->right;
+
+  x->right = y->left;
+  if(y->left)
+    y->left->parent = x;
+  y->parent = x->parent;
+  if(x->parent == 0)
+    t->root = y;
+  else if(x == x->parent->left)
+    x->parent->left = y;
+  else
+    x->parent->right = y;
+  y->left = x;
+  x->parent = y;
+}
+
+static void
+rb_rotate_right(struct rbtree *t, struct rbnode *x)
+{
+  struct rbnode *y = x->left;
+
+  x->left = y->right;
+  if(y->right)
+    y->right->parent = x;
+  y->parent = x->parent;
+  if(x->parent == 0)
+    t->root = y;
+  else if(x == x->parent->right)
+    x->parent->right = y;
+  else
+    x->parent->left = y;
+  y->right = x;
+  x->parent = y;
+}
+
+static int
+rb_isred(struct rbnode *n)
+{
+  return n != 0 && n->red;
+}
+
+// Restore the red-black properties after inserting red node z.
+static void
+rb_insert_fixup(struct rbtree *t, struct rbnode *z)
+{
+  struct rbnode *gp, *uncle;
+
+  while(rb_isred(z->parent)){
+    // z's parent is red, so it is not the root.
+    gp = z->parent->parent;
+    if(z->parent == gp->left){
+      uncle = gp->right;
+      if(rb_isred(uncle)){
+        z->parent->red = 0;
+        uncle->red = 0;
+        gp->red = 1;
+        z = gp;
+      } else {
+        if(z == z->parent->right){
+          z = z->parent;
+          rb_rotate_left(t, z);
+        }
+        z->parent->red = 0;
+        gp->red = 1;
+        rb_rotate_right(t, gp);
+      }
+    } else {
+      uncle = gp->left;
+      if(rb_isred(uncle)){
+        z->parent->red = 0;
+        uncle->red = 0;
+        gp->red = 1;
+        z = gp;
+      } else {
+        if(z == z->parent->left){
+          z = z->parent;
+          rb_rotate_right(t, z);
+        }
+        z->parent->red = 0;
+        gp->red = 1;
+        rb_rotate_left(t, gp);
+      }
+    }
+  }
+  t->root->red = 0;
+}
+
+// Add n to t, after any nodes that are not less than it.
+void
+rb_insert(struct rbtree *t, struct rbnode *n, int (*less)(struct rbnode*, struct rbnode*))
+{
+  struct rbnode **link = &t->root, *parent = 0;
+  int leftmost = 1;
+
+  while(*link){
+    parent = *link;
+    if(less(n, parent)){
+      link = &parent->left;
+    } else {
+      link = &parent->right;
+      leftmost = 0;
+    }
+  }
+
+  n->parent = parent;
+  n->left = 0;
+  n->right = 0;
+  n->red = 1;
+  *link = n;
+  if(leftmost)
+    t->leftmost = n;
+
+  rb_insert_fixup(t, n);
+}
+
+// Put v, which may be null, where u is in the tree.
+static void
+rb_transplant(struct rbtree *t, struct rbnode *u, struct rbnode *v)
+{
+  if(u->parent == 0)
+    t->root = v;
+  else if(u == u->parent->left)
+    u->parent->left = v;
+  else
+    u->parent->right = v;
+  if(v)
+    v->parent = u->parent;
+}
+
+// Restore the red-black properties after a black node was removed
+// from above x. x may be null, so its parent is passed separately.
+static void
+rb_erase_fixup(struct rbtree *t, struct rbnode *x, struct rbnode *parent)
+{
+  struct rbnode *w;
+
+  while(x != t->root && !rb_isred(x)){
+    if(x == parent->left){
+      w = parent->right;
+      if(w->red){
+        w->red = 0;
+        parent->red = 1;
+        rb_rotate_left(t, parent);
+        w = parent->right;
+      }
+      if(!rb_isred(w->left) && !rb_isred(w->right)){
+        w->red = 1;
+        x = parent;
+        parent = x->parent;
+      } else {
+        if(!rb_isred(w->right)){
+          w->left->red = 0;
+          w->red = 1;
+          rb_rotate_right(t, w);
+          w = parent->right;
+        }
+        w->red = parent->red;
+        parent->red = 0;
+        w->right->red = 0;
+        rb_rotate_left(t, parent);
+        x = t->root;
+      }
+    } else {
+      w = parent->left;
+      if(w->red){
+        w->red = 0;
+        parent->red = 1;
+        rb_rotate_right(t, parent);
+        w = parent->left;
+      }
+      if(!rb_isred(w->left) && !rb_isred(w->right)){
+        w->red = 1;
+        x = parent;
+        parent = x->parent;
+      } else {
+        if(!rb_isred(w->left)){
+          w->right->red = 0;
+          w->red = 1;
+          rb_rotate_left(t, w);
+          w = parent->left;
+        }
+        w->red = parent->red;
+        parent->red = 0;
+        w->left->red = 0;
+        rb_rotate_right(t, parent);
+        x = t->root;
+      }
+    }
+  }
+  if(x)
+    x->red = 0;
+}
+
+// Remove n from t.
+void
+rb_erase(struct rbtree *t, struct rbnode *n)
+{
+  struct rbnode *y, *x, *parent;
+  int removedred;
+
+  if(t->leftmost == n)
+    t->leftmost = rb_next(n);
+
+  if(n->left == 0){
+    x = n->right;
+    parent = n->parent;
+    removedred = n->red;
+    rb_transplant(t, n, n->right);
+  } else if(n->right == 0){
+    x = n->left;
+    parent = n->parent;
+    removedred = n->red;
+    rb_transplant(t, n, n->left);
+  } else {
+    // Replace n with its successor y, the leftmost node on its right.
+    y = n->right;
+    while(y->left)
+      y = y->left;
+    removedred = y->red;
+    x = y->right;
+    if(y->parent == n){
+      parent = y;
+    } else {
+      parent = y->parent;
+      rb_transplant(t, y, y->right);
+      y->right = n->right;
+      y->right->parent = y;
+    }
+    rb_transplant(t, n, y);
+    y->left = n->left;
+    y->left->parent = y;
+    y->red = n->red;
+  }
+
+  if(!removedred)
+    rb_erase_fixup(t, x, parent);
+}
+
+// The smallest node in t, or 0 if t is empty.
+struct rbnode*
+rb_first(struct rbtree *t)
+{
+  return t->leftmost;
+}
+
+// The largest node in t, or 0 if t is empty.
+struct rbnode*
+rb_last(struct rbtree *t)
+{
+  struct rbnode *n = t->root;
+
+  if(n == 0)
+    return 0;
+  while(n->right)
+    n = n->right;
+  return n;
+}
+
+// The node after n in order, or 0 if n is the last.
+struct rbnode*
+rb_next(struct rbnode *n)
+{
+  if(n->right){
+    n = n->right;
+    while(n->left)
+      n = n->left;
+    return n;
+  }
+  while(n->parent && n == n->parent->right)
+    n = n->parent;
+  return n->parent;
+}
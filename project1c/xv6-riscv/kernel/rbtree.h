@@ -0,0 +1,16 @@
+// Intrusive red-black tree. A node is embedded in the object it
+// orders; rb_entry() gets back from the node to the object.
+struct rbnode {
+  struct rbnode *parent;
+  struct rbnode *left;
+  struct rbnode *right;
+  int red;
+};
+
+struct rbtree {
+  struct rbnode *root;
+  struct rbnode *leftmost; // Smallest node, cached for rb_first()
+};
+
+#define rb_entry(node, type, member) \
+  ((type *)((char *)(node) - (uint64)&((type *)0)->member))
@@ -265,6 +265,15 @@ r_time()
   return x;
 }
 
+// this hart's cycle counter
+static inline uint64
+r_cycle()
+{
+  uint64 x;
+  asm volatile("csrr %0, cycle" : "=r" (x) );
+  return x;
+}
+
 // enable device interrupts
 static inline void
 intr_on()
@@ -319,6 +328,25 @@ r_ra()
   return x;
 }
 
+// read s0, which the kernel (built with -fno-omit-frame-pointer)
+// keeps as the frame pointer: the return address is at fp-8 and
+// the caller's fp at fp-16.
+static inline uint64
+r_fp()
+{
+  uint64 x;
+  asm volatile("mv %0, s0" : "=r" (x) );
+  return x;
+}
+
+// wait for an interrupt. returns once one is pending and
+// enabled in sie, even if sstatus.SIE is clear.
+static inline void
+wfi()
+{
+  asm volatile("wfi");
+}
+
 // flush the TLB.
 static inline void
 sfence_vma()
@@ -343,6 +371,7 @@ typedef uint64 *pagetable_t; // 512 PTEs
 #define PTE_W (1L << 2)
 #define PTE_X (1L << 3)
 #define PTE_U (1L << 4) // user can access
+#define PTE_COW (1L << 8) // software: copy on write, see uvmcow()
 
 // shift a physical address to the right place for a PTE.
 #define PA2PTE(pa) ((((uint64)pa) >> 12) << 10)
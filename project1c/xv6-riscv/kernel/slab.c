@@ -0,0 +1,273 @@
+// Slab allocator for kernel objects smaller than a page.
+//
+// A kmem_cache hands out objects of one size, carved from pages
+// got from kalloc(). Each page (a slab) starts with a struct slab
+// and holds as many objects as fit after it; its free objects are
+// linked through their first word, so kmem_cache_free() finds an
+// object's slab by rounding its address down to a page.
+//
+// Each hart keeps a magazine of free objects per cache, touched
+// only by that hart with interrupts off, so most allocations and
+// frees take no lock. The cache lock is taken to move half a
+// magazine between the magazine and the slabs. A cache keeps at
+// most one empty slab and gives others back to kalloc().
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rbtree.h"
+#include "proc.h"
+#include "slab.h"
+#include "defs.h"
+
+#define MAGSIZE 16
+
+struct slab {
+  struct kmem_cache *cache;
+  struct slab *next;    // in the cache's list of slabs with free objects
+  struct slab *prev;
+  void *free;           // free objects in this slab
+  int inuse;            // objects out of this slab, magazines included
+};
+
+struct magazine {
+  int n;
+  void *obj[MAGSIZE];
+};
+
+struct slabcount {
+  uint64 alloc;
+  uint64 free;
+  uint64 refill;
+  uint64 flush;
+};
+
+struct kmem_cache {
+  char name[SLAB_NAME];
+  uint size;
+  int perslab;
+
+  // lock must be held when using these:
+  struct spinlock lock;
+  struct slab *partial;  // slabs with free objects
+  int nslab;             // slabs in all
+  int nempty;            // slabs with no objects out
+
+  // touched only by their hart, with interrupts off:
+  struct magazine mag[NCPU];
+  struct slabcount count[NCPU];
+};
+
+static struct spinlock cacheslock;
+static struct kmem_cache caches[NSLABCACHE];
+static int ncache;
+
+void
+slabinit(void)
+{
+  initlock(&cacheslock, "slabcaches");
+}
+
+// Make a cache of objects of size bytes. Panics if the size is too
+// big for a slab or there are too many caches, since both are
+// mistakes in the kernel.
+struct kmem_cache *
+kmem_cache_create(char *name, uint size)
+{
+  struct kmem_cache *c;
+
+  size = (size + 7) & ~7;
+  if(size < sizeof(void*) || size > PGSIZE - sizeof(struct slab))
+    panic("kmem_cache_create: size");
+  acquire(&cacheslock);
+  if(ncache == NSLABCACHE)
+    panic("kmem_cache_create: too many");
+  c = &caches[ncache];
+  safestrcpy(c->name, name, sizeof(c->name));
+  c->size = size;
+  c->perslab = (PGSIZE - sizeof(struct slab)) / size;
+  initlock(&c->lock, "slab");
+  ncache++;
+  release(&cacheslock);
+  return c;
+}
+
+static void
+slab_unlink(struct kmem_cache *c, struct slab *s)
+{
+  if(s->prev)
+    s->prev->next = s->next;
+  else
+    c->partial = s->next;
+  if(s->next)
+    s->next->prev = s->prev;
+}
+
+// Add a fresh slab to c's partial list. Returns 0 if out of pages.
+// c->lock must be held.
+static struct slab *
+slab_grow(struct kmem_cache *c)
+{
+  struct slab *s;
+  char *obj;
+  int i;
+
+  if((s = (struct slab*)kalloc()) == 0)
+    return 0;
+  s->cache = c;
+  s->inuse = 0;
+  s->free = 0;
+  obj = (char*)s + sizeof(struct slab) + (c->perslab - 1) * c->size;
+  for(i = 0; i < c->perslab; i++, obj -= c->size){
+    *(void**)obj = s->free;
+    s->free = obj;
+  }
+  s->prev = 0;
+  s->next = c->partial;
+  if(c->partial)
+    c->partial->prev = s;
+  c->partial = s;
+  c->nslab++;
+  c->nempty++;
+  return s;
+}
+
+// Fill half of magazine m from the slabs, growing the cache
+// if they run out.
+static void
+mag_refill(struct kmem_cache *c, struct magazine *m)
+{
+  struct slab *s;
+  void *obj;
+
+  acquire(&c->lock);
+  while(m->n < MAGSIZE / 2){
+    if((s = c->partial) == 0 && (s = slab_grow(c)) == 0)
+      break;
+    obj = s->free;
+    s->free = *(void**)obj;
+    if(s->inuse++ == 0)
+      c->nempty--;
+    if(s->free == 0)
+      slab_unlink(c, s);
+    m->obj[m->n++] = obj;
+  }
+  release(&c->lock);
+}
+
+// Return half of magazine m to the slabs.
+static void
+mag_flush(struct kmem_cache *c, struct magazine *m)
+{
+  struct slab *s;
+  void *obj;
+
+  acquire(&c->lock);
+  while(m->n > MAGSIZE / 2){
+    obj = m->obj[--m->n];
+    s = (struct slab*)PGROUNDDOWN((uint64)obj);
+    if(s->free == 0){
+      s->prev = 0;
+      s->next = c->partial;
+      if(c->partial)
+        c->partial->prev = s;
+      c->partial = s;
+    }
+    *(void**)obj = s->free;
+    s->free = obj;
+    if(--s->inuse == 0){
+      if(c->nempty > 0){
+        slab_unlink(c, s);
+        c->nslab--;
+        kfree(s);
+      } else {
+        c->nempty++;
+      }
+    }
+  }
+  release(&c->lock);
+}
+
+// Allocate an object from c. Returns 0 if out of memory.
+// The object's contents are whatever was left there.
+void *
+kmem_cache_alloc(struct kmem_cache *c)
+{
+  struct magazine *m;
+  void *obj = 0;
+  int id;
+
+  push_off();
+  id = cpuid();
+  m = &c->mag[id];
+  if(m->n == 0){
+    c->count[id].refill++;
+    mag_refill(c, m);
+  }
+  if(m->n > 0){
+    obj = m->obj[--m->n];
+    c->count[id].alloc++;
+  }
+  pop_off();
+  return obj;
+}
+
+// Free an object that came from kmem_cache_alloc(c).
+void
+kmem_cache_free(struct kmem_cache *c, void *obj)
+{
+  struct magazine *m;
+  int id;
+
+  if(((struct slab*)PGROUNDDOWN((uint64)obj))->cache != c)
+    panic("kmem_cache_free");
+
+  push_off();
+  id = cpuid();
+  m = &c->mag[id];
+  if(m->n == MAGSIZE){
+    c->count[id].flush++;
+    mag_flush(c, m);
+  }
+  m->obj[m->n++] = obj;
+  c->count[id].free++;
+  pop_off();
+}
+
+// slabstat(buf, n): copy up to n records, one per cache, summed
+// over harts, to buf. returns the number of records copied.
+uint64
+sys_slabstat(void)
+{
+  uint64 buf;
+  int n, i, j, got;
+  struct slabstat st;
+  struct kmem_cache *c;
+
+  argaddr(0, &buf);
+  argint(1, &n);
+  acquire(&cacheslock);
+  got = ncache < n ? ncache : n;
+  release(&cacheslock);
+  for(i = 0; i < got; i++){
+    c = &caches[i];
+    memset(&st, 0, sizeof(st));
+    safestrcpy(st.name, c->name, sizeof(st.name));
+    st.size = c->size;
+    st.perslab = c->perslab;
+    acquire(&c->lock);
+    st.slabs = c->nslab;
+    release(&c->lock);
+    for(j = 0; j < NCPU; j++){
+      st.alloc += c->count[j].alloc;
+      st.free += c->count[j].free;
+      st.refill += c->count[j].refill;
+      st.flush += c->count[j].flush;
+    }
+    if(copyout(myproc()->pagetable, buf + i * sizeof(st), (char*)&st, sizeof(st)) < 0)
+      return -1;
+  }
+  return got;
+}
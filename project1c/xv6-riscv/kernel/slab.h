@@ -0,0 +1,14 @@
+// Slab allocator statistics, one record per cache.
+#define NSLABCACHE 16
+#define SLAB_NAME 16
+
+struct slabstat {
+  char name[SLAB_NAME];
+  uint size;         // bytes per object, after rounding
+  int perslab;       // objects per page
+  int slabs;         // pages the cache holds now
+  uint64 alloc;      // objects allocated
+  uint64 free;       // objects freed
+  uint64 refill;     // allocations that found the hart's magazine empty
+  uint64 flush;      // frees that found the hart's magazine full
+};
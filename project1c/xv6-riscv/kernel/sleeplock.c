@@ -6,6 +6,7 @@
 #include "param.h"
 #include "memlayout.h"
 #include "spinlock.h"
+#include "rbtree.h"
 #include "proc.h"
 #include "sleeplock.h"
 
@@ -16,17 +17,29 @@ initsleeplock(struct sleeplock *lk, char *name)
   lk->name = name;
   lk->locked = 0;
   lk->pid = 0;
+  lk->stat = lockstat_key(name, 1);
+  lk->acquiredAt = 0;
 }
 
 void
 acquiresleep(struct sleeplock *lk)
 {
+  uint64 start = 0;
+  int contended = 0;
+
   acquire(&lk->lk);
+  if(lockstaton && lk->stat)
+    start = r_time();
   while (lk->locked) {
+    contended = 1;
     sleep(lk, &lk->lk);
   }
   lk->locked = 1;
   lk->pid = myproc()->pid;
+  if(start != 0){
+    lk->acquiredAt = r_time();
+    lockstat_acquired(lk->stat, lk->acquiredAt - start, contended);
+  }
   release(&lk->lk);
 }
 
@@ -34,6 +47,10 @@ void
 releasesleep(struct sleeplock *lk)
 {
   acquire(&lk->lk);
+  if(lk->acquiredAt != 0){
+    lockstat_released(lk->stat, r_time() - lk->acquiredAt);
+    lk->acquiredAt = 0;
+  }
   lk->locked = 0;
   lk->pid = 0;
   wakeup(lk);
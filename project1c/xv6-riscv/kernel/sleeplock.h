@@ -6,5 +6,9 @@ struct sleeplock {
   // For debugging:
   char *name;        // Name of lock.
   int pid;           // Process holding lock
+
+  // For lockstat.c:
+  int stat;          // Statistics slot, 0 if none.
+  uint64 acquiredAt; // Time when acquired, 0 if not timed.
 };
 
@@ -5,6 +5,7 @@
 #include "memlayout.h"
 #include "spinlock.h"
 #include "riscv.h"
+#include "rbtree.h"
 #include "proc.h"
 #include "defs.h"
 
@@ -12,8 +13,11 @@ void
 initlock(struct spinlock *lk, char *name)
 {
   lk->name = name;
-  lk->locked = 0;
+  lk->next = 0;
+  lk->owner = 0;
   lk->cpu = 0;
+  lk->stat = lockstat_key(name, 0);
+  lk->acquiredAt = 0;
 }
 
 // Acquire the lock.
@@ -21,16 +25,26 @@ initlock(struct spinlock *lk, char *name)
 void
 acquire(struct spinlock *lk)
 {
+  uint64 start = 0;
+  int contended = 0;
+  uint ticket;
+
   push_off(); // disable interrupts to avoid deadlock.
   if(holding(lk))
     panic("acquire");
 
-  // On RISC-V, sync_lock_test_and_set turns into an atomic swap:
+  if(lockstaton && lk->stat)
+    start = r_cycle();
+
+  // On RISC-V, sync_fetch_and_add turns into an atomic add:
   //   a5 = 1
-  //   s1 = &lk->locked
-  //   amoswap.w.aq a5, a5, (s1)
-  while(__sync_lock_test_and_set(&lk->locked, 1) != 0)
-    ;
+  //   s1 = &lk->next
+  //   amoadd.w.aqrl a5, a5, (s1)
+  // Waiters then only read owner, so they share its cache line
+  // instead of each writing it as a test-and-set loop would.
+  ticket = __sync_fetch_and_add(&lk->next, 1);
+  while(*(volatile uint *)&lk->owner != ticket)
+    contended = 1;
 
   // Tell the C compiler and the processor to not move loads or stores
   // past this point, to ensure that the critical section's memory
@@ -40,6 +54,11 @@ acquire(struct spinlock *lk)
 
   // Record info about lock acquisition for holding() and debugging.
   lk->cpu = mycpu();
+
+  if(start != 0){
+    lk->acquiredAt = r_cycle();
+    lockstat_acquired(lk->stat, lk->acquiredAt - start, contended);
+  }
 }
 
 // Release the lock.
@@ -49,6 +68,11 @@ release(struct spinlock *lk)
   if(!holding(lk))
     panic("release");
 
+  if(lk->acquiredAt != 0){
+    lockstat_released(lk->stat, r_cycle() - lk->acquiredAt);
+    lk->acquiredAt = 0;
+  }
+
   lk->cpu = 0;
 
   // Tell the C compiler and the CPU to not move loads or stores
@@ -59,14 +83,11 @@ release(struct spinlock *lk)
   // On RISC-V, this emits a fence instruction.
   __sync_synchronize();
 
-  // Release the lock, equivalent to lk->locked = 0.
-  // This code doesn't use a C assignment, since the C standard
-  // implies that an assignment might be implemented with
-  // multiple store instructions.
-  // On RISC-V, sync_lock_release turns into an atomic swap:
-  //   s1 = &lk->locked
-  //   amoswap.w zero, zero, (s1)
-  __sync_lock_release(&lk->locked);
+  // Pass the lock to the next ticket. Only the holder writes
+  // owner, but this still uses an atomic add rather than a C
+  // assignment, since the C standard implies that an assignment
+  // might be implemented with multiple store instructions.
+  __sync_fetch_and_add(&lk->owner, 1);
 
   pop_off();
 }
@@ -77,7 +98,7 @@ int
 holding(struct spinlock *lk)
 {
   int r;
-  r = (lk->locked && lk->cpu == mycpu());
+  r = (*(volatile uint *)&lk->next != lk->owner && lk->cpu == mycpu());
   return r;
 }
 
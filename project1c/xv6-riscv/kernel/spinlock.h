@@ -1,9 +1,17 @@
 // Mutual exclusion lock.
+// A ticket lock: acquire() takes the next ticket and waits for
+// owner to reach it, so waiters get the lock in arrival order.
+// The lock is held whenever owner != next.
 struct spinlock {
-  uint locked;       // Is the lock held?
+  uint next;         // Next ticket to hand out.
+  uint owner;        // Ticket of the holder.
 
   // For debugging:
   char *name;        // Name of lock.
   struct cpu *cpu;   // The cpu holding the lock.
+
+  // For lockstat.c:
+  int stat;          // Statistics slot, 0 if none.
+  uint64 acquiredAt; // Cycle when acquired, 0 if not timed.
 };
 
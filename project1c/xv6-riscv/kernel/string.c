@@ -105,3 +105,19 @@ strlen(const char *s)
   return n;
 }
 
+
+// Return the 1-based index of the least significant set bit
+// in x, or 0 if x is 0. Branch-free (de Bruijn multiply), since
+// the kernel has no libgcc to back __builtin_ctz.
+int
+ffs(uint x)
+{
+  static const uchar pos[32] = {
+    0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+    31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+  };
+
+  if(x == 0)
+    return 0;
+  return pos[((x & -x) * 0x077CB531U) >> 27] + 1;
+}
@@ -3,8 +3,11 @@
 #include "memlayout.h"
 #include "riscv.h"
 #include "spinlock.h"
+#include "rbtree.h"
 #include "proc.h"
 #include "syscall.h"
+#include "sysstat.h"
+#include "trace.h"
 #include "defs.h"
 
 // Fetch the uint64 at addr from the current process.
@@ -102,11 +105,37 @@ extern uint64 sys_close(void);
 extern uint64 sys_getppid(void);
 extern uint64 sys_ps(void);
 extern uint64 sys_getschedhistory(void);
+extern uint64 sys_getschedlatency(void);
+extern uint64 sys_profctl(void);
+extern uint64 sys_profread(void);
+extern uint64 sys_tracectl(void);
+extern uint64 sys_traceread(void);
+extern uint64 sys_getsysstat(void);
+extern uint64 sys_lockstat(void);
+extern uint64 sys_getlockstat(void);
+extern uint64 sys_lockbench(void);
+extern uint64 sys_futex_wait(void);
+extern uint64 sys_futex_wake(void);
+extern uint64 sys_clone(void);
+extern uint64 sys_join(void);
+extern uint64 sys_sigalarm(void);
+extern uint64 sys_sigreturn(void);
+extern uint64 sys_kmemstat(void);
+extern uint64 sys_slabstat(void);
+extern uint64 sys_buddystat(void);
+extern uint64 sys_buddytest(void);
 
 // Prototypes for the MLFQ scheduler system calls
 int sys_startMLFQ(void);
 int sys_stopMLFQ(void);
 int sys_getMLFQInfo(void);
+int sys_setMLFQPolicy(void);
+int sys_startStride(void);
+int sys_stopStride(void);
+int sys_setTickets(void);
+int sys_setScheduler(void);
+int sys_sched_setdeadline(void);
+int sys_setNice(void);
 
 
 
@@ -144,20 +173,87 @@ static uint64 (*syscalls[])(void) = {
     [SYS_startMLFQ] (void*)startMLFQ,
     [SYS_stopMLFQ] (void*)stopMLFQ,
     [SYS_getMLFQInfo] (void*)getMLFQInfo,
+    [SYS_setMLFQPolicy] (void*)setMLFQPolicy,
+    [SYS_startStride] (void*)startStride,
+    [SYS_stopStride] (void*)stopStride,
+    [SYS_setTickets] (void*)setTickets,
+    [SYS_setScheduler] (void*)setScheduler,
+    [SYS_sched_setdeadline] (void*)sched_setdeadline,
+    [SYS_setNice] (void*)setNice,
+    [SYS_getschedlatency] sys_getschedlatency,
+    [SYS_profctl] sys_profctl,
+    [SYS_profread] sys_profread,
+    [SYS_tracectl] sys_tracectl,
+    [SYS_traceread] sys_traceread,
+    [SYS_getsysstat] sys_getsysstat,
+    [SYS_lockstat] sys_lockstat,
+    [SYS_getlockstat] sys_getlockstat,
+    [SYS_lockbench] sys_lockbench,
+    [SYS_futex_wait] sys_futex_wait,
+    [SYS_futex_wake] sys_futex_wake,
+    [SYS_clone] sys_clone,
+    [SYS_join] sys_join,
+    [SYS_sigalarm] sys_sigalarm,
+    [SYS_sigreturn] sys_sigreturn,
+    [SYS_kmemstat] sys_kmemstat,
+    [SYS_slabstat] sys_slabstat,
+    [SYS_buddystat] sys_buddystat,
+    [SYS_buddytest] sys_buddytest,
 
 };
 
+static struct sysstat sysstats[NCPU][NSYSCALL];
+
+// Account for a call to num that started on hart at cycle start
+// and returned ret. Cycle counters are per hart, so a call that
+// slept and woke up elsewhere is counted but not timed.
+static void
+sysstat_record(int num, int hart, uint64 start, uint64 ret)
+{
+  struct sysstat *s;
+  uint64 t;
+  int i;
+
+  push_off();
+  t = r_cycle() - start;
+  s = &sysstats[cpuid()][num];
+  s->count++;
+  if ((long)ret < 0)
+    s->errors++;
+  if (cpuid() != hart)
+  {
+    s->migrated++;
+  }
+  else
+  {
+    s->cycles += t;
+    for (i = 0; (t >>= 1) != 0 && i < NLATBUCKET - 1; i++)
+      ;
+    s->hist[i]++;
+  }
+  pop_off();
+}
+
 void syscall(void)
 {
-  int num;
+  int num, hart;
+  uint64 start;
   struct proc *p = myproc();
 
   num = p->trapframe->a7;
   if (num > 0 && num < NELEM(syscalls) && syscalls[num])
   {
+    push_off();
+    hart = cpuid();
+    start = r_cycle();
+    pop_off();
+
     // Use num to lookup the system call function for num, call it,
     // and store its return value in p->trapframe->a0
+    TRACE(TR_SYSCALL, num, p->trapframe->a0);
     p->trapframe->a0 = syscalls[num]();
+    TRACE(TR_SYSRET, num, p->trapframe->a0);
+    sysstat_record(num, hart, start, p->trapframe->a0);
   }
   else
   {
@@ -166,3 +262,34 @@ void syscall(void)
     p->trapframe->a0 = -1;
   }
 }
+
+// getsysstat(buf): copy the statistics for every system call
+// number, summed over harts, to buf, an array of NSYSCALL
+// struct sysstat. Returns NSYSCALL.
+uint64
+sys_getsysstat(void)
+{
+  uint64 buf;
+  struct sysstat sum;
+  struct sysstat *s;
+  int num, i, j;
+
+  argaddr(0, &buf);
+  for (num = 0; num < NSYSCALL; num++)
+  {
+    memset(&sum, 0, sizeof(sum));
+    for (i = 0; i < NCPU; i++)
+    {
+      s = &sysstats[i][num];
+      sum.count += s->count;
+      sum.errors += s->errors;
+      sum.migrated += s->migrated;
+      sum.cycles += s->cycles;
+      for (j = 0; j < NLATBUCKET; j++)
+        sum.hist[j] += s->hist[j];
+    }
+    if (copyout(myproc()->pagetable, buf + num * sizeof(sum), (char *)&sum, sizeof(sum)) < 0)
+      return -1;
+  }
+  return NSYSCALL;
+}
@@ -31,4 +31,30 @@
 #define SYS_startMLFQ 25
 #define SYS_stopMLFQ 26
 #define SYS_getMLFQInfo 27
+#define SYS_setMLFQPolicy 28
+#define SYS_startStride 29
+#define SYS_stopStride 30
+#define SYS_setTickets 31
+#define SYS_setScheduler 32
+#define SYS_sched_setdeadline 33
+#define SYS_setNice 34
+#define SYS_getschedlatency 35
+#define SYS_profctl 36
+#define SYS_profread 37
+#define SYS_tracectl 38
+#define SYS_traceread 39
+#define SYS_getsysstat 40
+#define SYS_lockstat 41
+#define SYS_getlockstat 42
+#define SYS_lockbench 43
+#define SYS_futex_wait 44
+#define SYS_futex_wake 45
+#define SYS_clone 46
+#define SYS_join 47
+#define SYS_sigalarm 48
+#define SYS_sigreturn 49
+#define SYS_kmemstat 50
+#define SYS_slabstat 51
+#define SYS_buddystat 52
+#define SYS_buddytest 53
 
@@ -4,6 +4,7 @@
 #include "param.h"
 #include "memlayout.h"
 #include "spinlock.h"
+#include "rbtree.h"
 #include "proc.h"
 
 uint64
@@ -42,8 +43,7 @@ sys_sbrk(void)
   int n;
 
   argint(0, &n);
-  addr = myproc()->sz;
-  if (growproc(n) < 0)
+  if (growproc(n, &addr) < 0)
     return -1;
   return addr;
 }
@@ -206,3 +206,116 @@ sys_getschedhistory(void)
   // Return the pid as well
   return curproc->pid;
 }
+
+// Report the scheduling latency histograms of process pid, or of
+// the caller if pid is 0, so one process can watch another's.
+uint64
+sys_getschedlatency(void)
+{
+  int pid;
+  uint64 arg_addr;
+  struct proc *p;
+  struct schedLatency lat;
+
+  argint(0, &pid);
+  argaddr(1, &arg_addr);
+  if (pid == 0)
+    pid = myproc()->pid;
+
+  for (p = proc; p < &proc[NPROC]; p++)
+  {
+    acquire(&p->lock);
+    if (p->pid == pid && p->state != UNUSED)
+    {
+      lat = p->lat;
+      release(&p->lock);
+      if (copyout(myproc()->pagetable, arg_addr, (char *)&lat, sizeof(lat)) < 0)
+        return -1;
+      return 0;
+    }
+    release(&p->lock);
+  }
+  return -1;
+}
+
+// Shared by every caller of lockbench(). Never initlock()ed, so
+// lockstat leaves it alone.
+static struct spinlock benchlock = { .name = "lockbench" };
+static uint64 benchcount;
+
+// lockbench(end): acquire and release benchlock, with a short
+// critical section, until ticks reaches end. Returns how many times
+// this process got the lock.
+uint64
+sys_lockbench(void)
+{
+  int end;
+  uint64 n = 0;
+
+  argint(0, &end);
+  while ((int)(*(volatile uint *)&ticks - end) < 0)
+  {
+    acquire(&benchlock);
+    benchcount++;
+    release(&benchlock);
+    n++;
+  }
+  return n;
+}
+
+uint64
+sys_clone(void)
+{
+  uint64 fn, arg, stack;
+
+  argaddr(0, &fn);
+  argaddr(1, &arg);
+  argaddr(2, &stack);
+  return clone(fn, arg, stack);
+}
+
+uint64
+sys_join(void)
+{
+  int tid;
+  uint64 p;
+
+  argint(0, &tid);
+  argaddr(1, &p);
+  return join(tid, p);
+}
+
+// sigalarm(ticks, handler): after every ticks ticks of cpu time,
+// run handler(), which must end by calling sigreturn(). A ticks of
+// 0 turns the alarm off.
+uint64
+sys_sigalarm(void)
+{
+  int n;
+  uint64 handler;
+  struct proc *p = myproc();
+
+  argint(0, &n);
+  argaddr(1, &handler);
+  if (n < 0)
+    return -1;
+  p->alarmInterval = n;
+  p->alarmHandler = handler;
+  p->alarmTicks = n;
+  return 0;
+}
+
+// Return from a sigalarm() handler to where the upcall interrupted
+// the process, with all its registers as they were.
+uint64
+sys_sigreturn(void)
+{
+  struct proc *p = myproc();
+
+  if (!p->alarmActive)
+    return -1;
+  *(p->trapframe) = p->alarmFrame;
+  p->alarmActive = 0;
+  // syscall() stores this in a0, so give back the saved one.
+  return p->trapframe->a0;
+}
@@ -0,0 +1,10 @@
+// Per-system-call statistics, kept per hart by syscall().
+#define NSYSCALL 64   // larger than any system call number
+
+struct sysstat {
+  uint64 count;      // calls that returned
+  uint64 errors;     // calls that returned a negative value
+  uint64 migrated;   // calls that returned on another hart, so untimed
+  uint64 cycles;     // total cycles in timed calls
+  uint hist[NLATBUCKET]; // log2 histogram of cycles per timed call
+};
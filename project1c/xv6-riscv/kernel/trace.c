@@ -0,0 +1,137 @@
+// Event tracing.
+//
+// Each hart appends events to its own ring with interrupts off, so
+// a ring has a single producer and needs no lock on that side:
+// the producer owns head, readers own tail, and an event becomes
+// visible when head moves past it. When a ring is full new events
+// are dropped and counted. Readers take the ring's lock only to
+// serialize among themselves.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rbtree.h"
+#include "proc.h"
+#include "trace.h"
+#include "defs.h"
+
+struct tracering {
+  struct spinlock lock;  // serializes readers
+  struct traceevent buf[TRACE_NEVENT];
+  volatile uint head;    // events written, advanced by the hart
+  volatile uint tail;    // events read, advanced by readers
+  volatile uint dropped; // events lost to a full ring
+  uint dropseen;         // dropped as of the last read
+};
+
+static struct tracering rings[NCPU];
+volatile int traceon;
+
+void
+traceinit(void)
+{
+  for(int i = 0; i < NCPU; i++)
+    initlock(&rings[i].lock, "trace");
+}
+
+// Record an event on this hart. Use TRACE(), which skips the call
+// while tracing is off.
+void
+trace(int type, uint64 a0, uint64 a1)
+{
+  struct tracering *r;
+  struct traceevent *e;
+  struct cpu *c;
+  uint h;
+
+  push_off();
+  c = mycpu();
+  r = &rings[cpuid()];
+  h = r->head;
+  if(h - r->tail == TRACE_NEVENT){
+    r->dropped++;
+  } else {
+    e = &r->buf[h % TRACE_NEVENT];
+    e->time = r_time();
+    e->arg[0] = a0;
+    e->arg[1] = a1;
+    e->type = type;
+    e->hart = cpuid();
+    e->pid = c->proc ? c->proc->pid : 0;
+    __sync_synchronize();
+    r->head = h + 1;
+  }
+  pop_off();
+}
+
+// tracectl(on): start (discarding buffered events) or stop tracing.
+// returns whether tracing was on before.
+uint64
+sys_tracectl(void)
+{
+  int on, old, i;
+  struct tracering *r;
+
+  argint(0, &on);
+  old = traceon;
+  if(on && !old){
+    for(i = 0; i < NCPU; i++){
+      r = &rings[i];
+      acquire(&r->lock);
+      r->tail = r->head;
+      r->dropseen = r->dropped;
+      release(&r->lock);
+    }
+  }
+  traceon = on != 0;
+  return old;
+}
+
+// traceread(buf, n, dropped): copy up to n buffered events, oldest
+// first within each hart, to buf. if dropped is not 0, store the
+// number of events lost to full rings since the last read.
+// returns the number of events copied.
+uint64
+sys_traceread(void)
+{
+  uint64 buf, dst;
+  int n, got, i;
+  uint dropped, d, t;
+  struct tracering *r;
+  struct traceevent e;
+  struct proc *p = myproc();
+
+  argaddr(0, &buf);
+  argint(1, &n);
+  argaddr(2, &dst);
+
+  got = 0;
+  dropped = 0;
+  for(i = 0; i < NCPU; i++){
+    r = &rings[i];
+    for(;;){
+      acquire(&r->lock);
+      t = r->tail;
+      if(got == n || t == r->head){
+        d = r->dropped;
+        dropped += d - r->dropseen;
+        r->dropseen = d;
+        release(&r->lock);
+        break;
+      }
+      __sync_synchronize();
+      e = r->buf[t % TRACE_NEVENT];
+      __sync_synchronize();
+      r->tail = t + 1;
+      release(&r->lock);
+      if(copyout(p->pagetable, buf + got * sizeof(e), (char*)&e, sizeof(e)) < 0)
+        return -1;
+      got++;
+    }
+  }
+  if(dst != 0 && copyout(p->pagetable, dst, (char*)&dropped, sizeof(dropped)) < 0)
+    return -1;
+  return got;
+}
@@ -0,0 +1,33 @@
+// Static tracepoints.
+//
+// TRACE() costs one branch on traceon while tracing is off. While
+// it is on, each event is appended to the current hart's ring as
+// a fixed-size record stamped with the time CSR.
+
+#define TRACE_NEVENT 1024  // events buffered per hart
+
+// event types; arg[0] and arg[1] as noted
+#define TR_SCHED     1   // process gives up the cpu: new state
+#define TR_SWTCH     2   // scheduler switches to pid: pid, time queued
+#define TR_SLEEP     3   // sleep: chan, exclusive
+#define TR_WAKEUP    4   // wakeup: chan, pid woken
+#define TR_SYSCALL   5   // syscall entry: number, first argument
+#define TR_SYSRET    6   // syscall exit: number, return value
+#define TR_BREAD     7   // bread: blockno, cache hit
+#define TR_BWRITE    8   // bwrite: blockno
+#define TR_BEGIN_OP  9   // begin_op done: outstanding ops
+#define TR_END_OP    10  // end_op: outstanding ops, committing
+#define TR_DISKINTR  11  // virtio_disk_intr: requests completed
+
+struct traceevent {
+  uint64 time;    // time CSR
+  uint64 arg[2];
+  ushort type;    // TR_*
+  ushort hart;
+  int pid;        // process running on hart, 0 if none
+};
+
+extern volatile int traceon;
+
+#define TRACE(type, a0, a1) \
+  do { if(traceon) trace((type), (uint64)(a0), (uint64)(a1)); } while(0)
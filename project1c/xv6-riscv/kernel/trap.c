@@ -3,6 +3,7 @@
 #include "memlayout.h"
 #include "riscv.h"
 #include "spinlock.h"
+#include "rbtree.h"
 #include "proc.h"
 #include "defs.h"
 
@@ -16,6 +17,9 @@ void kernelvec();
 
 extern int devintr();
 
+// in start.c; timervec sets [6] on each timer interrupt.
+extern uint64 timer_scratch[NCPU][7];
+
 void trapinit(void)
 {
   initlock(&tickslock, "time");
@@ -27,6 +31,23 @@ void trapinithart(void)
   w_stvec((uint64)kernelvec);
 }
 
+// Charge p a tick of cpu toward its sigalarm() interval. When the
+// interval is up, save the user registers and return to the handler
+// instead; sigreturn() puts them back. Upcalls don't nest, so ticks
+// spent in the handler count toward the next one.
+static void
+alarmtick(struct proc *p)
+{
+  if (p->alarmInterval == 0 || --p->alarmTicks > 0)
+    return;
+  p->alarmTicks = p->alarmInterval;
+  if (p->alarmActive)
+    return;
+  p->alarmFrame = *(p->trapframe);
+  p->alarmActive = 1;
+  p->trapframe->epc = p->alarmHandler;
+}
+
 //
 // handle an interrupt, exception, or system call from user space.
 // called from trampoline.S
@@ -72,6 +93,12 @@ void usertrap(void)
     // ok
     p->interruptCount++; // Added code to increment interruptCount
   }
+  else if ((r_scause() == 13 || r_scause() == 15) &&
+           pagefault(p->pagetable, r_stval(), r_scause() == 15) == 0)
+  {
+    // load or store to a page not mapped yet, or a store to a
+    // copy-on-write page; it's there now.
+  }
   else
   {
     printf("usertrap(): unexpected scause %p pid=%d\n", r_scause(), p->pid);
@@ -79,11 +106,18 @@ void usertrap(void)
     setkilled(p);
   }
 
+  if (which_dev == 2)
+  {
+    profsample(p, 1, p->trapframe->epc, p->trapframe->s0);
+    alarmtick(p);
+  }
+
   if (killed(p))
     exit(-1);
 
-  // give up the CPU if this is a timer interrupt.
-  if (which_dev == 2)
+  // give up the CPU if this is a timer interrupt
+  // and the scheduler wants it back.
+  if (which_dev == 2 && sched_tick(p))
   {
     p->preemptCount++; // Added code to increment preemptCount
     yield();
@@ -131,10 +165,11 @@ void usertrapret(void)
   uint64 satp = MAKE_SATP(p->pagetable);
 
   // jump to userret in trampoline.S at the top of memory, which
-  // switches to the user page table, restores user registers,
-  // and switches to user mode with sret.
+  // switches to the user page table, restores user registers
+  // from the trapframe at p->tfva, and switches to user mode
+  // with sret.
   uint64 trampoline_userret = TRAMPOLINE + (userret - trampoline);
-  ((void (*)(uint64))trampoline_userret)(satp);
+  ((void (*)(uint64, uint64))trampoline_userret)(satp, p->tfva);
 }
 
 // interrupts and exceptions from kernel code go here via kernelvec,
@@ -158,8 +193,15 @@ void kerneltrap()
     panic("kerneltrap");
   }
 
-  // give up the CPU if this is a timer interrupt.
-  if (which_dev == 2 && myproc() != 0 && myproc()->state == RUNNING)
+  // kernelvec leaves s0 alone, so the interrupted code's frame
+  // pointer is the one saved in kerneltrap's own frame record.
+  if (which_dev == 2)
+    profsample(myproc(), 0, sepc, *(uint64 *)(r_fp() - 16));
+
+  // give up the CPU if this is a timer interrupt
+  // and the scheduler wants it back.
+  if (which_dev == 2 && myproc() != 0 && myproc()->state == RUNNING &&
+      sched_tick(myproc()))
   {
 
     myproc()->preemptCount++; // Added code to increment preemptCount
@@ -172,12 +214,21 @@ void kerneltrap()
   w_sstatus(sstatus);
 }
 
+// Send an inter-processor interrupt to hart, e.g. to wake it from
+// wfi. Arrives as a machine software interrupt, which timervec
+// passes on as a supervisor software interrupt.
+void ipi(int hart)
+{
+  *(uint32 *)CLINT_MSIP(hart) = 1;
+}
+
 void clockintr()
 {
   acquire(&tickslock);
   ticks++;
   wakeup(&ticks);
   release(&tickslock);
+  sched_clock();
 }
 
 // check if it's an external interrupt or software interrupt,
@@ -220,18 +271,23 @@ int devintr()
   }
   else if (scause == 0x8000000000000001L)
   {
-    // software interrupt from a machine-mode timer interrupt,
-    // forwarded by timervec in kernelvec.S.
+    // software interrupt from a machine-mode timer interrupt
+    // or IPI, forwarded by timervec in kernelvec.S.
+
+    // acknowledge the software interrupt by clearing
+    // the SSIP bit in sip.
+    w_sip(r_sip() & ~2);
+
+    // timervec flags timer interrupts; anything else was an ipi()
+    // to get an idle hart out of wfi to look at its run queue.
+    if (__sync_lock_test_and_set(&timer_scratch[cpuid()][6], 0) == 0)
+      return 1;
 
     if (cpuid() == 0)
     {
       clockintr();
     }
 
-    // acknowledge the software interrupt by clearing
-    // the SSIP bit in sip.
-    w_sip(r_sip() & ~2);
-
     return 2;
   }
   else
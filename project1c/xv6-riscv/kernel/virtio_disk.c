@@ -7,6 +7,7 @@
 
 #include "types.h"
 #include "riscv.h"
+#include "trace.h"
 #include "defs.h"
 #include "param.h"
 #include "memlayout.h"
@@ -309,6 +310,8 @@ virtio_disk_intr()
   // the device increments disk.used->idx when it
   // adds an entry to the used ring.
 
+  TRACE(TR_DISKINTR, (uint16)(disk.used->idx - disk.used_idx), 0);
+
   while(disk.used_idx != disk.used->idx){
     __sync_synchronize();
     int id = disk.used->ring[disk.used_idx % NUM].id;
@@ -15,6 +15,14 @@ extern char etext[];  // kernel.ld sets this to end of kernel code.
 
 extern char trampoline[]; // trampoline.S
 
+// a page of zeros, mapped copy-on-write by read faults on heap
+// pages never written; see uvmfault().
+static char *zeropage;
+
+// Heap pages sbrk() grew over are backed by a page kreserve()
+// promised until they are written: every page below a process's
+// sz that is unmapped, or maps zeropage, holds one promised page.
+
 // Make a direct-map page table for the kernel.
 pagetable_t
 kvmmake(void)
@@ -30,6 +38,9 @@ kvmmake(void)
   // virtio mmio disk interface
   kvmmap(kpgtbl, VIRTIO0, VIRTIO0, PGSIZE, PTE_R | PTE_W);
 
+  // CLINT software interrupt registers, for ipi()
+  kvmmap(kpgtbl, CLINT, CLINT, PGSIZE, PTE_R | PTE_W);
+
   // PLIC
   kvmmap(kpgtbl, PLIC, PLIC, 0x400000, PTE_R | PTE_W);
 
@@ -54,6 +65,9 @@ void
 kvminit(void)
 {
   kernel_pagetable = kvmmake();
+  if((zeropage = kalloc()) == 0)
+    panic("kvminit: zeropage");
+  memset(zeropage, 0, PGSIZE);
 }
 
 // Switch h/w page table register to the kernel's page table,
@@ -96,6 +110,7 @@ walk(pagetable_t pagetable, uint64 va, int alloc)
       if(!alloc || (pagetable = (pde_t*)kalloc()) == 0)
         return 0;
       memset(pagetable, 0, PGSIZE);
+      __sync_synchronize();   // zeroed before fork() can see it
       *pte = PA2PTE(pagetable) | PTE_V;
     }
   }
@@ -165,30 +180,45 @@ mappages(pagetable_t pagetable, uint64 va, uint64 size, uint64 pa, int perm)
 }
 
 // Remove npages of mappings starting from va. va must be
-// page-aligned. The mappings must exist.
+// page-aligned. Pages that were never mapped, such as heap pages
+// sbrk() grew over but nothing touched, are skipped, a whole
+// page-table page at a time where there is none.
 // Optionally free the physical memory.
-void
+// Returns the number of those pages, and of ones mapping zeropage.
+uint64
 uvmunmap(pagetable_t pagetable, uint64 va, uint64 npages, int do_free)
 {
-  uint64 a;
+  uint64 a, next, end = va + npages*PGSIZE, unbacked = 0;
   pte_t *pte;
 
   if((va % PGSIZE) != 0)
     panic("uvmunmap: not aligned");
 
-  for(a = va; a < va + npages*PGSIZE; a += PGSIZE){
-    if((pte = walk(pagetable, a, 0)) == 0)
-      panic("uvmunmap: walk");
-    if((*pte & PTE_V) == 0)
-      panic("uvmunmap: not mapped");
+  for(a = va; a < end; a += PGSIZE){
+    if((pte = walk(pagetable, a, 0)) == 0){
+      // no level-0 page table: skip to the next one.
+      next = (a | ((1L << PXSHIFT(1)) - 1)) + 1;
+      if(next > end)
+        next = end;
+      unbacked += (next - a) / PGSIZE;
+      a = next - PGSIZE;
+      continue;
+    }
+    if((*pte & PTE_V) == 0){
+      unbacked++;
+      continue;
+    }
     if(PTE_FLAGS(*pte) == PTE_V)
       panic("uvmunmap: not a leaf");
+    if(PTE2PA(*pte) == (uint64)zeropage)
+      unbacked++;
     if(do_free){
       uint64 pa = PTE2PA(*pte);
       kfree((void*)pa);
     }
     *pte = 0;
   }
+  return unbacked;
 }
 
 // create an empty user page table.
@@ -260,7 +290,7 @@ uvmdealloc(pagetable_t pagetable, uint64 oldsz, uint64 newsz)
 
   if(PGROUNDUP(newsz) < PGROUNDUP(oldsz)){
     int npages = (PGROUNDUP(oldsz) - PGROUNDUP(newsz)) / PGSIZE;
-    uvmunmap(pagetable, PGROUNDUP(newsz), npages, 1);
+    kunreserve(uvmunmap(pagetable, PGROUNDUP(newsz), npages, 1));
   }
 
   return newsz;
@@ -292,31 +322,47 @@ void
 uvmfree(pagetable_t pagetable, uint64 sz)
 {
   if(sz > 0)
-    uvmunmap(pagetable, 0, PGROUNDUP(sz)/PGSIZE, 1);
+    kunreserve(uvmunmap(pagetable, 0, PGROUNDUP(sz)/PGSIZE, 1));
   freewalk(pagetable);
 }
 
 // Given a parent process's page table, copy
 // its memory into a child's page table.
-// Copies both the page table and the
-// physical memory.
+// If cow is set, the child shares the parent's physical pages,
+// and writable ones become copy-on-write in both; otherwise it
+// gets copies of them. Heap pages not written yet stay that way,
+// so the child needs pages promised for them too.
 // returns 0 on success, -1 on failure.
 // frees any allocated pages on failure.
 int
-uvmcopy(pagetable_t old, pagetable_t new, uint64 sz)
+uvmcopy(pagetable_t old, pagetable_t new, uint64 sz, int cow)
 {
   pte_t *pte;
-  uint64 pa, i;
+  uint64 pa, i, unbacked = 0;
   uint flags;
   char *mem;
 
   for(i = 0; i < sz; i += PGSIZE){
-    if((pte = walk(old, i, 0)) == 0)
-      panic("uvmcopy: pte should exist");
-    if((*pte & PTE_V) == 0)
-      panic("uvmcopy: page not present");
+    if((pte = walk(old, i, 0)) == 0 || (*pte & PTE_V) == 0){
+      unbacked++;
+      continue;
+    }
     pa = PTE2PA(*pte);
     flags = PTE_FLAGS(*pte);
+    if(cow){
+      if(pa == (uint64)zeropage)
+        unbacked++;
+      // the parent's TLB entries go when it returns to user
+      // space, since userret flushes the TLB.
+      if(flags & PTE_W){
+        flags = (flags & ~PTE_W) | PTE_COW;
+        *pte = PA2PTE(pa) | flags;
+      }
+      if(mappages(new, i, PGSIZE, pa, flags) != 0)
+        goto err;
+      kdup((void*)pa);
+      continue;
+    }
     if((mem = kalloc()) == 0)
       goto err;
     memmove(mem, (char*)pa, PGSIZE);
@@ -325,6 +371,8 @@ uvmcopy(pagetable_t old, pagetable_t new, uint64 sz)
       goto err;
     }
   }
+  if(kreserve(unbacked) < 0)
+    goto err;
   return 0;
 
  err:
@@ -332,6 +380,101 @@ uvmcopy(pagetable_t old, pagetable_t new, uint64 sz)
   return -1;
 }
 
+// Make the copy-on-write page at va writable, copying it first
+// unless no other page table refers to it any more.
+// Returns 0, or -1 if va isn't copy-on-write or memory ran out.
+int
+uvmcow(pagetable_t pagetable, uint64 va)
+{
+  pte_t *pte;
+  uint64 pa;
+  uint flags;
+  char *mem;
+
+  if(va >= MAXVA || (pte = walk(pagetable, PGROUNDDOWN(va), 0)) == 0)
+    return -1;
+  if((*pte & (PTE_V|PTE_U|PTE_COW)) != (PTE_V|PTE_U|PTE_COW))
+    return -1;
+  pa = PTE2PA(*pte);
+  flags = (PTE_FLAGS(*pte) & ~PTE_COW) | PTE_W;
+  if(krefs((void*)pa) == 1){
+    *pte = PA2PTE(pa) | flags;
+    return 0;
+  }
+  if((mem = kalloc()) == 0)
+    return -1;
+  memmove(mem, (char*)pa, PGSIZE);
+  *pte = PA2PTE(mem) | flags;
+  if(pa == (uint64)zeropage)
+    kunreserve(1);
+  kfree((void*)pa);
+  return 0;
+}
+
+// Handle a user page fault at va, below the process size sz, that
+// a load (or store, if write) took. A page sbrk() grew over is
+// mapped now: zero-filled for a store, and for a load the shared
+// zero page, copy-on-write, unless the page table is shared with
+// threads. A store to a copy-on-write page copies it.
+// Returns 0 if the access can be retried, -1 if it is at fault.
+// The caller must keep other threads out; see pagefault().
+int
+uvmfault(pagetable_t pagetable, uint64 va, uint64 sz, int write, int shared)
+{
+  pte_t *pte;
+  char *mem;
+
+  if(va >= sz || va >= MAXVA)
+    return -1;
+  va = PGROUNDDOWN(va);
+  if((pte = walk(pagetable, va, 1)) == 0)
+    return -1;
+
+  if(*pte & PTE_V){
+    if((*pte & PTE_U) == 0)
+      return -1;              // the stack guard page
+    if(write && (*pte & PTE_COW))
+      return uvmcow(pagetable, va);
+    if(write && (*pte & PTE_W) == 0)
+      return -1;
+    return 0;                 // another thread mapped it first
+  }
+
+  if(!write && !shared){
+    kdup(zeropage);
+    *pte = PA2PTE(zeropage) | PTE_R | PTE_U | PTE_COW | PTE_V;
+    return 0;
+  }
+  if((mem = kalloc()) == 0)
+    return -1;
+  kunreserve(1);
+  memset(mem, 0, PGSIZE);
+  // fork() copies a shared page table without the lock, so the
+  // page must be zeroed before it can see the PTE.
+  __sync_synchronize();
+  *pte = PA2PTE(mem) | PTE_R | PTE_W | PTE_U | PTE_V;
+  return 0;
+}
+
+// Copy every copy-on-write page below sz, so that none is left.
+// clone() does this first: a thread's TLB could keep the old
+// page after another thread's write fault replaced it.
+// Returns 0, or -1 if memory ran out.
+int
+uvmuncow(pagetable_t pagetable, uint64 sz)
+{
+  pte_t *pte;
+  uint64 va;
+
+  for(va = 0; va < sz; va += PGSIZE){
+    if((pte = walk(pagetable, va, 0)) == 0)
+      continue;
+    if((*pte & PTE_COW) && uvmcow(pagetable, va) < 0)
+      return -1;
+  }
+  return 0;
+}
+
 // mark a PTE invalid for user access.
 // used by exec for the user stack guard page.
 void
@@ -352,12 +495,23 @@ int
 copyout(pagetable_t pagetable, uint64 dstva, char *src, uint64 len)
 {
   uint64 n, va0, pa0;
+  pte_t *pte;
 
   while(len > 0){
     va0 = PGROUNDDOWN(dstva);
-    pa0 = walkaddr(pagetable, va0);
-    if(pa0 == 0)
+    if(va0 >= MAXVA)
+      return -1;
+    // fault the page in, or copy it if it is shared, as a user
+    // store would.
+    pte = walk(pagetable, va0, 0);
+    if(pte == 0 || (*pte & (PTE_V|PTE_COW)) != PTE_V){
+      if(pagefault(pagetable, va0, 1) < 0)
+        return -1;
+      pte = walk(pagetable, va0, 0);
+    }
+    if((*pte & (PTE_V|PTE_U|PTE_W)) != (PTE_V|PTE_U|PTE_W))
       return -1;
+    pa0 = PTE2PA(*pte);
     n = PGSIZE - (dstva - va0);
     if(n > len)
       n = len;
@@ -381,6 +535,8 @@ copyin(pagetable_t pagetable, char *dst, uint64 srcva, uint64 len)
   while(len > 0){
     va0 = PGROUNDDOWN(srcva);
     pa0 = walkaddr(pagetable, va0);
+    if(pa0 == 0 && pagefault(pagetable, va0, 0) == 0)
+      pa0 = walkaddr(pagetable, va0);
     if(pa0 == 0)
       return -1;
     n = PGSIZE - (srcva - va0);
@@ -408,6 +564,8 @@ copyinstr(pagetable_t pagetable, char *dst, uint64 srcva, uint64 max)
   while(got_null == 0 && max > 0){
     va0 = PGROUNDDOWN(srcva);
     pa0 = walkaddr(pagetable, va0);
+    if(pa0 == 0 && pagefault(pagetable, va0, 0) == 0)
+      pa0 = walkaddr(pagetable, va0);
     if(pa0 == 0)
       return -1;
     n = PGSIZE - (srcva - va0);
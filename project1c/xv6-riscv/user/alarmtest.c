@@ -0,0 +1,90 @@
+// alarmtest: check sigalarm() and sigreturn().
+//
+// usage: alarmtest
+//
+// Spins with a sigalarm() handler installed and checks that the
+// handler runs, that the interrupted code sees its registers and
+// stack unchanged, and that sigalarm(0, 0) turns the upcalls off.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+static volatile int count;
+
+static void
+handler(void)
+{
+  count++;
+  sigreturn();
+}
+
+// A register-heavy loop whose result is known; it comes out wrong
+// if an upcall clobbers any of its state.
+static uint64
+churn(int n)
+{
+  uint64 a = 1, b = 2, c = 3, d = 4, e = 5, f = 6;
+  int i;
+
+  for(i = 0; i < n; i++){
+    a += b ^ i;
+    b += c + (a >> 3);
+    c ^= d + i;
+    d += e * 3;
+    e ^= f + (c << 1);
+    f += a;
+  }
+  return a ^ b ^ c ^ d ^ e ^ f;
+}
+
+int
+main(int argc, char *argv[])
+{
+  uint64 want, got;
+  int i, start, n, fail = 0;
+
+  want = churn(1000000);
+
+  // upcalls arrive while spinning.
+  count = 0;
+  if(sigalarm(2, handler) < 0){
+    fprintf(2, "alarmtest: sigalarm failed\n");
+    exit(1);
+  }
+  start = uptime();
+  for(i = 0; i < 50 && count < 5; i++)
+    got = churn(1000000);
+  printf("%d upcalls in %d ticks\n", count, uptime() - start);
+  if(count == 0){
+    printf("alarmtest: handler never ran\n");
+    fail = 1;
+  }
+
+  // the interrupted code doesn't notice.
+  for(i = 0; i < 5; i++){
+    if((got = churn(1000000)) != want){
+      printf("alarmtest: registers clobbered: %l != %l\n", got, want);
+      fail = 1;
+      break;
+    }
+  }
+
+  // and they stop when turned off.
+  sigalarm(0, 0);
+  n = count;
+  for(i = 0; i < 10; i++)
+    churn(1000000);
+  if(count != n){
+    printf("alarmtest: %d upcalls after sigalarm(0, 0)\n", count - n);
+    fail = 1;
+  }
+
+  if(sigreturn() != -1){
+    printf("alarmtest: sigreturn outside a handler succeeded\n");
+    fail = 1;
+  }
+
+  printf(fail ? "alarmtest: FAIL\n" : "alarmtest: OK\n");
+  exit(fail);
+}
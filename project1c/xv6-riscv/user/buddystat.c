@@ -0,0 +1,48 @@
+// buddystat: show how fragmented free physical memory is.
+//
+// usage: buddystat      show the free lists
+//        buddystat -t   run the allocator's self-test (buddytest())
+//
+// For each order, free is the number of free blocks of 2^order
+// pages, and usable% the share of free pages sitting in blocks at
+// least that big, so how much of free memory kalloc_pages(order)
+// could still hand out. Pages in the per-hart caches of kalloc()
+// are not counted.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/kmemstat.h"
+#include "user/user.h"
+
+static struct buddystat st;
+
+int
+main(int argc, char *argv[])
+{
+  int nfree, order, above, i;
+
+  if(argc > 1 && strcmp(argv[1], "-t") == 0){
+    if(buddytest() < 0){
+      printf("buddystat: self-test FAILED\n");
+      exit(1);
+    }
+    printf("buddystat: self-test OK\n");
+    exit(0);
+  }
+
+  if((nfree = buddystat(&st)) < 0){
+    fprintf(2, "buddystat: buddystat failed\n");
+    exit(1);
+  }
+
+  printf("order kb free usable%% alloc fail\n");
+  for(order = 0; order < NBUDDYORDER; order++){
+    above = 0;
+    for(i = order; i < NBUDDYORDER; i++)
+      above += st.nblock[i] << i;
+    printf("%d %d %d %d %l %l\n", order, 4 << order, st.nblock[order],
+           nfree ? above * 100 / nfree : 0, st.alloc[order], st.fail[order]);
+  }
+  printf("%d pages free; %l splits, %l merges\n", nfree, st.split, st.merge);
+  exit(0);
+}
@@ -0,0 +1,107 @@
+// cfstest: check that CFS weights the cpu by nice value.
+//
+// usage: cfstest
+//
+// Starts two CPU-bound children, one at nice 0 and one at nice 5,
+// and lets them compete on one hart (CPUS=1, the default) for
+// RUNTICKS ticks, counting how many times each gets round its loop.
+// Under CFS the weights are 1024 and 335, so the counts should come
+// out about 3:1; under round-robin, run the same way as a control,
+// about even. Also checks that setNice() refuses values outside
+// -20..19. Leaves the scheduling class it found.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define RUNTICKS 60
+
+static int nices[2] = {0, 5};
+static uint64 count[2];
+
+// Run a child at each of nices[] until RUNTICKS ticks from now, and
+// fill count[] with the loops each managed.
+static void
+run(void)
+{
+  int go[2], out[2], i, end;
+  struct {
+    int who;
+    uint64 n;
+  } msg;
+
+  if(pipe(go) < 0 || pipe(out) < 0){
+    fprintf(2, "cfstest: pipe failed\n");
+    exit(1);
+  }
+  for(i = 0; i < 2; i++){
+    int pid = fork();
+    if(pid < 0){
+      fprintf(2, "cfstest: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      close(go[1]);
+      close(out[0]);
+      if(setNice(nices[i]) < 0 || read(go[0], &end, sizeof(end)) != sizeof(end))
+        exit(1);
+      msg.who = i;
+      msg.n = 0;
+      while(uptime() < end)
+        msg.n++;
+      write(out[1], &msg, sizeof(msg));
+      exit(0);
+    }
+  }
+  close(go[0]);
+  close(out[1]);
+  memset(count, 0, sizeof(count));
+  end = uptime() + RUNTICKS;
+  for(i = 0; i < 2; i++)
+    write(go[1], &end, sizeof(end));
+  close(go[1]);
+  while(read(out[0], &msg, sizeof(msg)) == sizeof(msg))
+    count[msg.who] = msg.n;
+  close(out[0]);
+  for(i = 0; i < 2; i++)
+    wait(0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int old, fail = 0;
+
+  if(setNice(-21) >= 0 || setNice(20) >= 0){
+    printf("cfstest: setNice() took a value out of range\n");
+    fail = 1;
+  }
+  setNice(0);
+
+  if((old = setScheduler(SCHED_CFS)) < 0){
+    fprintf(2, "cfstest: can't start CFS\n");
+    exit(1);
+  }
+  run();
+  printf("cfs: nice %d %l loops, nice %d %l loops\n",
+         nices[0], count[0], nices[1], count[1]);
+  // 1024/335 is about 3.06; allow 2.3 to 4.
+  if(count[1] == 0 || count[0] * 10 < count[1] * 23 || count[0] * 10 > count[1] * 40){
+    printf("cfstest: nice %d didn't get about 3 times the cpu of nice %d\n",
+           nices[0], nices[1]);
+    fail = 1;
+  }
+
+  setScheduler(SCHED_RR);
+  run();
+  printf("round-robin: nice %d %l loops, nice %d %l loops\n",
+         nices[0], count[0], nices[1], count[1]);
+  if(count[1] == 0 || count[0] * 4 < count[1] * 3 || count[0] * 4 > count[1] * 5){
+    printf("cfstest: round-robin didn't share the cpu evenly\n");
+    fail = 1;
+  }
+
+  setScheduler(old);
+  printf(fail ? "cfstest: FAIL\n" : "cfstest: OK\n");
+  exit(fail);
+}
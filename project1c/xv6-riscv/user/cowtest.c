@@ -0,0 +1,86 @@
+// cowtest: check copy-on-write fork and time it.
+//
+// usage: cowtest [pages]   (default 1024, at least 2)
+//
+// Grows the heap by pages pages, then checks that writes by a child
+// (through stores and through read() into the heap) aren't seen by
+// the parent, and the other way round. Then times forks of a child
+// that exits at once, so touches almost none of that memory.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define PGSIZE 4096
+
+int
+main(int argc, char *argv[])
+{
+  int npages, i, pid, fds[2], status, start, nfork = 50, fail = 0;
+  char *mem;
+
+  npages = argc > 1 ? atoi(argv[1]) : 1024;
+  if(npages < 2){
+    fprintf(2, "usage: cowtest [pages], at least 2\n");
+    exit(1);
+  }
+  if((mem = sbrk(npages * PGSIZE)) == (char*)-1){
+    fprintf(2, "cowtest: sbrk failed\n");
+    exit(1);
+  }
+  for(i = 0; i < npages; i++)
+    mem[i * PGSIZE] = 'p';
+
+  // the child's stores and read()s stay in the child.
+  if(pipe(fds) < 0){
+    fprintf(2, "cowtest: pipe failed\n");
+    exit(1);
+  }
+  if((pid = fork()) < 0){
+    fprintf(2, "cowtest: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    close(fds[1]);
+    for(i = 0; i < npages; i += 2)
+      mem[i * PGSIZE] = 'c';
+    if(read(fds[0], mem + PGSIZE, 1) != 1)
+      exit(1);
+    for(i = 0; i < npages; i += 2)
+      if(mem[i * PGSIZE] != 'c')
+        exit(1);
+    exit(mem[PGSIZE] == 'x' ? 0 : 1);
+  }
+  close(fds[0]);
+  mem[(npages - 1) * PGSIZE] = 'P';   // and the parent's in the parent
+  write(fds[1], "x", 1);
+  close(fds[1]);
+  wait(&status);
+  if(status != 0){
+    printf("cowtest: child saw the wrong memory\n");
+    fail = 1;
+  }
+  for(i = 0; i < npages - 1; i++){
+    if(mem[i * PGSIZE] != 'p'){
+      printf("cowtest: parent sees the child's write at page %d\n", i);
+      fail = 1;
+      break;
+    }
+  }
+
+  start = uptime();
+  for(i = 0; i < nfork; i++){
+    if((pid = fork()) < 0){
+      fprintf(2, "cowtest: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0)
+      exit(0);
+    wait(0);
+  }
+  printf("%d forks of a %d-page process in %d ticks\n", nfork, npages,
+         uptime() - start);
+
+  printf(fail ? "cowtest: FAIL\n" : "cowtest: OK\n");
+  exit(fail);
+}
@@ -0,0 +1,166 @@
+// dltest: check sched_setdeadline(): admission, budgets, and
+// replenishment.
+//
+// usage: dltest
+//
+// Admission: a request with runtime > deadline or deadline > period
+// is refused, as is any that would take the share of a cpu that
+// deadline processes reserve, the sum of runtime/deadline, past 90%
+// (DL_BW_MAX); a process that exits gives its share back.
+//
+// Budgets: a child with runtime 2 of every period of 10 ticks spins
+// for RUNTICKS ticks against an ordinary CPU-bound child, on one
+// hart (CPUS=1, the default), and counts the ticks it saw itself
+// running in. It should get about a fifth of them: its budget in
+// full, but well short of the half round-robin would give it, so it
+// was throttled; and in both halves of the run, so its budget was
+// replenished.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define RUNTICKS 60
+#define RUNTIME  2
+#define PERIOD   10
+
+static int fail;
+
+static void
+check(int ok, char *what)
+{
+  if(!ok){
+    printf("dltest: %s\n", what);
+    fail = 1;
+  }
+}
+
+// Run f() in a child and return its exit status.
+static int
+inchild(int (*f)(void))
+{
+  int pid, status;
+
+  if((pid = fork()) < 0){
+    fprintf(2, "dltest: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0)
+    exit(f());
+  wait(&status);
+  return status;
+}
+
+// With the parent holding 50%, another 50% is too much but 30%
+// fits. Exits holding the 30%.
+static int
+admit(void)
+{
+  if(sched_setdeadline(5, 10, 10) == 0)
+    return 1;
+  if(sched_setdeadline(3, 10, 10) < 0)
+    return 2;
+  return 0;
+}
+
+static void
+admission(void)
+{
+  check(sched_setdeadline(3, 10, 2) < 0, "runtime > deadline was accepted");
+  check(sched_setdeadline(2, 5, 10) < 0, "deadline > period was accepted");
+  check(sched_setdeadline(19, 20, 20) < 0, "95% of a cpu was accepted");
+
+  if(sched_setdeadline(5, 10, 10) < 0){
+    check(0, "50% of a cpu was refused");
+    return;
+  }
+  switch(inchild(admit)){
+  case 1:
+    check(0, "two reservations of 50% were both accepted");
+    break;
+  case 2:
+    check(0, "30% was refused on top of 50%");
+    break;
+  }
+  sched_setdeadline(0, 0, 0);
+
+  // the child's 30% went with it, so all 90% is free again.
+  check(sched_setdeadline(9, 10, 10) == 0, "an exited process kept its reservation");
+  sched_setdeadline(0, 0, 0);
+}
+
+// Spin until end; seen[0] and seen[1] count the ticks before and
+// after mid that this process ran in.
+static void
+spin(int mid, int end, int *seen)
+{
+  int t, last = -1;
+
+  while((t = uptime()) < end){
+    if(t != last){
+      seen[t >= mid]++;
+      last = t;
+    }
+  }
+}
+
+static void
+budget(void)
+{
+  int go[2], out[2], i, end, seen[2];
+
+  if(pipe(go) < 0 || pipe(out) < 0){
+    fprintf(2, "dltest: pipe failed\n");
+    exit(1);
+  }
+  for(i = 0; i < 2; i++){
+    int pid = fork();
+    if(pid < 0){
+      fprintf(2, "dltest: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      close(go[1]);
+      close(out[0]);
+      if(i == 0 && sched_setdeadline(RUNTIME, PERIOD, PERIOD) < 0)
+        exit(1);
+      if(read(go[0], &end, sizeof(end)) != sizeof(end))
+        exit(1);
+      seen[0] = seen[1] = 0;
+      spin(end - RUNTICKS / 2, end, seen);
+      if(i == 0)
+        write(out[1], seen, sizeof(seen));
+      exit(0);
+    }
+  }
+  close(go[0]);
+  close(out[1]);
+  end = uptime() + RUNTICKS;
+  for(i = 0; i < 2; i++)
+    write(go[1], &end, sizeof(end));
+  close(go[1]);
+  if(read(out[0], seen, sizeof(seen)) != sizeof(seen)){
+    check(0, "deadline child didn't report");
+    seen[0] = seen[1] = 0;
+  }
+  close(out[0]);
+  for(i = 0; i < 2; i++)
+    wait(0);
+
+  printf("runtime %d of every %d ticks: ran in %d of the first %d ticks, %d of the last %d\n",
+         RUNTIME, PERIOD, seen[0], RUNTICKS / 2, seen[1], RUNTICKS / 2);
+  // about RUNTIME per PERIOD, give or take a tick per period seen
+  // on either side of a switch.
+  check(seen[0] + seen[1] >= RUNTICKS / PERIOD * RUNTIME / 2, "deadline child didn't get its budget");
+  check(seen[0] + seen[1] <= RUNTICKS / PERIOD * (RUNTIME + 1), "deadline child wasn't throttled");
+  check(seen[0] > 0 && seen[1] > 0, "deadline child's budget wasn't replenished");
+}
+
+int
+main(int argc, char *argv[])
+{
+  admission();
+  budget();
+  printf(fail ? "dltest: FAIL\n" : "dltest: OK\n");
+  exit(fail);
+}
@@ -0,0 +1,70 @@
+// kmemstat: show how each hart's page cache is doing.
+//
+// usage: kmemstat             totals since boot
+//        kmemstat cmd arg...  totals for the duration of cmd
+//
+// hit% is the share of kalloc()s that took no lock but the hart's
+// own. refills, steals, and drains count batches moved between a
+// hart's cache and the buddy allocator or another hart's cache.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "kernel/kmemstat.h"
+#include "user/user.h"
+
+static struct kmemstat before[NCPU], after[NCPU];
+
+static int
+snapshot(struct kmemstat *s)
+{
+  int nfree;
+
+  if((nfree = kmemstat(s, NCPU)) < 0){
+    fprintf(2, "kmemstat: kmemstat failed\n");
+    exit(1);
+  }
+  return nfree;
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct kmemstat *a, *b;
+  uint64 alloc = 0, hit = 0;
+  int i, pid, nfree;
+
+  if(argc > 1){
+    snapshot(before);
+    pid = fork();
+    if(pid < 0){
+      fprintf(2, "kmemstat: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      exec(argv[1], argv + 1);
+      fprintf(2, "kmemstat: exec %s failed\n", argv[1]);
+      exit(1);
+    }
+    while(wait(0) != pid)
+      ;
+  }
+  nfree = snapshot(after);
+
+  printf("hart alloc hit%% refill steal drain fail free cached\n");
+  for(i = 0; i < NCPU; i++){
+    a = &after[i];
+    b = &before[i];
+    if(a->alloc == b->alloc && a->free == b->free)
+      continue;
+    printf("%d %l %l %l %l %l %l %l %d\n", i, a->alloc - b->alloc,
+           a->alloc > b->alloc ? (a->hit - b->hit) * 100 / (a->alloc - b->alloc) : 0,
+           a->refill - b->refill, a->steal - b->steal, a->drain - b->drain,
+           a->fail - b->fail, a->free - b->free, a->cached);
+    alloc += a->alloc - b->alloc;
+    hit += a->hit - b->hit;
+  }
+  printf("total %l allocs, %l%% hits; %d pages free outside the caches\n",
+         alloc, alloc ? hit * 100 / alloc : 0, nfree);
+  exit(0);
+}
@@ -0,0 +1,122 @@
+// lazytest: check that sbrk() maps heap pages only when touched.
+//
+// usage: lazytest [pages]   (default 8192, 32MB)
+//
+// Grows the heap by pages pages and checks that free memory barely
+// moves, that untouched pages read as zero, that stores and
+// system calls reading or writing untouched pages work, and that
+// shrinking the heap again gives the touched pages back. Page-table
+// pages stay until exit, so a few dozen pages stay in use. Also
+// checks that growing the heap past what memory could back fails.
+// The fork() needs pages promised for the child's untouched heap
+// too, so pages can be at most about half of memory.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "kernel/kmemstat.h"
+#include "kernel/memlayout.h"
+#include "user/user.h"
+
+#define PGSIZE 4096
+
+static struct kmemstat st[NCPU];
+
+// free pages, in the buddy allocator and the per-hart caches.
+static int
+freepages(void)
+{
+  int n, i;
+
+  n = kmemstat(st, NCPU);
+  for(i = 0; i < NCPU; i++)
+    n += st[i].cached;
+  return n;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int npages, i, before, after, fds[2], fail = 0;
+  char *mem;
+
+  npages = argc > 1 ? atoi(argv[1]) : 8192;
+  if(npages < 16){
+    fprintf(2, "usage: lazytest [pages], at least 16\n");
+    exit(1);
+  }
+
+  before = freepages();
+  if((mem = sbrk(npages * PGSIZE)) == (char*)-1){
+    fprintf(2, "lazytest: sbrk failed\n");
+    exit(1);
+  }
+  after = freepages();
+  printf("sbrk of %d pages used %d pages\n", npages, before - after);
+  if(before - after > 64){
+    printf("lazytest: sbrk allocated memory up front\n");
+    fail = 1;
+  }
+
+  // loads of untouched pages see zeros, and stores stick.
+  for(i = 0; i < npages; i += 1024)
+    if(mem[i * PGSIZE] != 0 || mem[i * PGSIZE + PGSIZE - 1] != 0){
+      printf("lazytest: untouched page %d isn't zero\n", i);
+      fail = 1;
+    }
+  for(i = 0; i < npages; i += 1024)
+    mem[i * PGSIZE + 7] = i / 1024 + 1;
+  for(i = 0; i < npages; i += 1024)
+    if(mem[i * PGSIZE + 7] != i / 1024 + 1 || mem[i * PGSIZE] != 0){
+      printf("lazytest: page %d lost a store\n", i);
+      fail = 1;
+    }
+
+  // the kernel reads and writes untouched pages too.
+  if(pipe(fds) < 0){
+    fprintf(2, "lazytest: pipe failed\n");
+    exit(1);
+  }
+  if(write(fds[1], mem + 3 * PGSIZE, 16) != 16){
+    printf("lazytest: write() from an untouched page failed\n");
+    fail = 1;
+  }
+  if(read(fds[0], mem + 5 * PGSIZE, 16) != 16 || mem[5 * PGSIZE] != 0){
+    printf("lazytest: read() into an untouched page failed\n");
+    fail = 1;
+  }
+  close(fds[0]);
+  close(fds[1]);
+
+  // more than all of memory can't be promised.
+  if(sbrk(PHYSTOP - KERNBASE) != (char*)-1){
+    printf("lazytest: sbrk of all of memory succeeded\n");
+    fail = 1;
+    sbrk(-(PHYSTOP - KERNBASE));
+  }
+
+  // the child sees the same heap.
+  if((i = fork()) < 0){
+    fprintf(2, "lazytest: fork failed\n");
+    exit(1);
+  }
+  if(i == 0)
+    exit(mem[7] == 1 && mem[PGSIZE] == 0 ? 0 : 1);
+  wait(&i);
+  if(i != 0){
+    printf("lazytest: child saw the wrong heap\n");
+    fail = 1;
+  }
+
+  // shrinking gives it all back.
+  sbrk(-npages * PGSIZE);
+  after = freepages();
+  printf("after shrinking, %d pages still used\n", before - after);
+  if(before - after > 64){
+    printf("lazytest: shrinking didn't free the touched pages\n");
+    fail = 1;
+  }
+
+  printf(fail ? "lazytest: FAIL\n" : "lazytest: OK\n");
+  exit(fail);
+}
@@ -0,0 +1,76 @@
+// lockbench: spinlock throughput and fairness with 1 to NCPU
+// processes hammering one kernel spinlock.
+//
+// usage: lockbench [ticks]
+//
+// For each process count, all processes start on the same tick and
+// call lockbench() until ticks more have passed. Reports the total
+// acquisitions per tick and the fewest and most any one process
+// got; min/max near 100% means the lock is fair. Run with as many
+// harts as processes (make CPUS=8 qemu) for the numbers to mean
+// anything.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "user/user.h"
+
+int
+main(int argc, char *argv[])
+{
+  int n, i, duration, start, fds[2];
+  uint64 count, total, min, max;
+
+  duration = argc > 1 ? atoi(argv[1]) : 20;
+  if(duration <= 0){
+    fprintf(2, "usage: lockbench [ticks]\n");
+    exit(1);
+  }
+
+  printf("procs acquires/tick min max min/max%%\n");
+  for(n = 1; n <= NCPU; n++){
+    if(pipe(fds) < 0){
+      fprintf(2, "lockbench: pipe failed\n");
+      exit(1);
+    }
+    start = uptime() + 2;
+    for(i = 0; i < n; i++){
+      int pid = fork();
+      if(pid < 0){
+        fprintf(2, "lockbench: fork failed\n");
+        exit(1);
+      }
+      if(pid == 0){
+        close(fds[0]);
+        while(uptime() < start)
+          ;
+        count = lockbench(start + duration);
+        write(fds[1], &count, sizeof(count));
+        exit(0);
+      }
+    }
+    close(fds[1]);
+
+    total = 0;
+    min = ~0UL;
+    max = 0;
+    for(i = 0; i < n; i++){
+      if(read(fds[0], &count, sizeof(count)) != sizeof(count)){
+        fprintf(2, "lockbench: short read\n");
+        exit(1);
+      }
+      total += count;
+      if(count < min)
+        min = count;
+      if(count > max)
+        max = count;
+    }
+    close(fds[0]);
+    for(i = 0; i < n; i++)
+      wait(0);
+
+    printf("%d %l %l %l %l\n", n, total / duration, min, max,
+           max ? min * 100 / max : 0);
+  }
+  exit(0);
+}
@@ -0,0 +1,83 @@
+// lockstat: show lock contention and hold times by lock name.
+//
+// usage: lockstat cmd arg...   collect while cmd runs
+//        lockstat -t ticks     collect for ticks ticks
+//        lockstat              show what is collected so far
+//
+// Locks are listed by total wait, most first. Spinlock times are
+// in cycles, sleeplock times (marked "sleep") in time CSR ticks.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/lockstat.h"
+#include "user/user.h"
+
+static struct lockstat stats[NLOCKSTAT];
+
+static void
+report(void)
+{
+  int order[NLOCKSTAT];
+  int n, i, j;
+  struct lockstat *s;
+
+  if((n = getlockstat(stats, NLOCKSTAT)) < 0){
+    fprintf(2, "lockstat: getlockstat failed\n");
+    exit(1);
+  }
+  for(i = 0; i < n; i++){
+    for(j = i; j > 0 && stats[order[j-1]].wait < stats[i].wait; j--)
+      order[j] = order[j-1];
+    order[j] = i;
+  }
+
+  printf("name kind acquire contended wait waitmax hold holdmax\n");
+  for(i = 0; i < n; i++){
+    s = &stats[order[i]];
+    if(s->acquire == 0)
+      continue;
+    printf("%s %s %l %l %l %l %l %l\n", s->name, s->sleep ? "sleep" : "spin",
+           s->acquire, s->contended, s->wait, s->waitmax, s->hold, s->holdmax);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid;
+
+  if(argc == 1){
+    report();
+    exit(0);
+  }
+
+  if(strcmp(argv[1], "-t") == 0){
+    if(argc != 3){
+      fprintf(2, "usage: lockstat -t ticks\n");
+      exit(1);
+    }
+    lockstat(1);
+    sleep(atoi(argv[2]));
+    lockstat(0);
+    report();
+    exit(0);
+  }
+
+  lockstat(1);
+  pid = fork();
+  if(pid < 0){
+    lockstat(0);
+    fprintf(2, "lockstat: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    exec(argv[1], argv + 1);
+    fprintf(2, "lockstat: exec %s failed\n", argv[1]);
+    exit(1);
+  }
+  while(wait(0) != pid)
+    ;
+  lockstat(0);
+  report();
+  exit(0);
+}
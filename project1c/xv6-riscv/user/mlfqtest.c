@@ -0,0 +1,177 @@
+// mlfqtest: check that setMLFQPolicy() shapes MLFQ scheduling.
+//
+// usage: mlfqtest
+//
+// Runs MLFQ with three levels and, under a few policies, starts a
+// CPU-bound child (the hog) and, in some runs, a child that runs to
+// the next tick and then sleeps (the napper). They compete on one
+// hart (CPUS=1, the default) for RUNTICKS ticks, and getMLFQInfo()
+// in each shows where it ended up:
+//  - the hog runs exactly quantum[0], then quantum[1] ticks at the
+//    top two levels before it reaches the bottom one;
+//  - under MLFQ_DEMOTE_SLICE the napper, whose every burst is
+//    shorter than its quantum, stays at the top level; under
+//    MLFQ_DEMOTE_ALLOTMENT its bursts add up and it sinks too;
+//  - a boost period lifts the hog back to the top level.
+// Also checks that bad policies are refused. Leaves the default
+// policy in place, and the scheduling class it found.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define RUNTICKS 40
+
+static struct MLFQPolicy pol;
+static struct MLFQInfoReport info[2];   // hog, napper
+static int fail;
+
+// The kernel's default quanta (2, 4, 6, ...), but for the top two.
+static int
+setpolicy(int q0, int q1, int boost, int demotion)
+{
+  int i;
+
+  for(i = 0; i < MLFQ_MAX_LEVEL; i++)
+    pol.quantum[i] = 2 * (i + 1);
+  pol.quantum[0] = q0;
+  pol.quantum[1] = q1;
+  pol.boostPeriod = boost;
+  pol.demotion = demotion;
+  return setMLFQPolicy(&pol);
+}
+
+static void
+hog(int end)
+{
+  while(uptime() < end)
+    ;
+}
+
+// spin to the next tick, so that each burst is charged a tick,
+// then sleep through one.
+static void
+nap(int end)
+{
+  int t;
+
+  while((t = uptime()) < end){
+    while(uptime() == t)
+      ;
+    sleep(1);
+  }
+}
+
+// Run the hog, and the napper too if napper is set, until RUNTICKS
+// ticks from now; then fill info[] from their getMLFQInfo().
+static void
+run(int napper)
+{
+  int go[2], out[2], i, n, end;
+  struct {
+    int who;
+    struct MLFQInfoReport r;
+  } msg;
+
+  n = napper ? 2 : 1;
+  if(pipe(go) < 0 || pipe(out) < 0){
+    fprintf(2, "mlfqtest: pipe failed\n");
+    exit(1);
+  }
+  for(i = 0; i < n; i++){
+    int pid = fork();
+    if(pid < 0){
+      fprintf(2, "mlfqtest: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      close(go[1]);
+      close(out[0]);
+      if(read(go[0], &end, sizeof(end)) != sizeof(end))
+        exit(1);
+      if(i == 0)
+        hog(end);
+      else
+        nap(end);
+      msg.who = i;
+      getMLFQInfo(&msg.r);
+      write(out[1], &msg, sizeof(msg));
+      exit(0);
+    }
+  }
+  close(go[0]);
+  close(out[1]);
+  memset(info, 0, sizeof(info));
+  end = uptime() + RUNTICKS;
+  for(i = 0; i < n; i++)
+    write(go[1], &end, sizeof(end));
+  close(go[1]);
+  while(read(out[0], &msg, sizeof(msg)) == sizeof(msg))
+    info[msg.who] = msg.r;
+  close(out[0]);
+  for(i = 0; i < n; i++)
+    wait(0);
+}
+
+static void
+check(int ok, char *what)
+{
+  if(!ok){
+    printf("mlfqtest: %s\n", what);
+    fail = 1;
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int old;
+
+  // bad policies.
+  check(setpolicy(0, 4, 0, MLFQ_DEMOTE_ALLOTMENT) < 0, "a quantum of 0 was accepted");
+  check(setpolicy(2, 4, -1, MLFQ_DEMOTE_ALLOTMENT) < 0, "a negative boost period was accepted");
+  check(setpolicy(2, 4, 0, 2) < 0, "an unknown demotion rule was accepted");
+
+  // three levels, and no aging boost from the bottom during a run.
+  old = setScheduler(SCHED_RR);
+  if(old < 0 || startMLFQ(3, 1000) < 0){
+    fprintf(2, "mlfqtest: can't start MLFQ\n");
+    exit(1);
+  }
+
+  // the quanta set how long the hog stays at each level.
+  setpolicy(2, 4, 0, MLFQ_DEMOTE_ALLOTMENT);
+  run(1);
+  printf("quanta 2,4 allotment: hog ran %d,%d,%d ticks, napper %d,%d,%d, at level %d\n",
+         info[0].tickCounts[0], info[0].tickCounts[1], info[0].tickCounts[2],
+         info[1].tickCounts[0], info[1].tickCounts[1], info[1].tickCounts[2],
+         info[1].priority);
+  check(info[0].tickCounts[0] == 2 && info[0].tickCounts[1] == 4,
+        "hog didn't use quanta of 2 and 4 ticks");
+  check(info[0].priority == 2 && info[0].tickCounts[2] > 0, "hog didn't reach the bottom");
+  check(info[1].priority == 2, "napper's bursts didn't add up under MLFQ_DEMOTE_ALLOTMENT");
+
+  setpolicy(3, 6, 0, MLFQ_DEMOTE_SLICE);
+  run(1);
+  printf("quanta 3,6 slice: hog ran %d,%d,%d ticks, napper %d,%d,%d, at level %d\n",
+         info[0].tickCounts[0], info[0].tickCounts[1], info[0].tickCounts[2],
+         info[1].tickCounts[0], info[1].tickCounts[1], info[1].tickCounts[2],
+         info[1].priority);
+  check(info[0].tickCounts[0] == 3 && info[0].tickCounts[1] == 6,
+        "hog didn't use quanta of 3 and 6 ticks");
+  check(info[1].priority == 0 && info[1].tickCounts[1] == 0,
+        "napper left the top level under MLFQ_DEMOTE_SLICE");
+
+  // a boost puts the hog back at the top for another quantum.
+  setpolicy(2, 4, 10, MLFQ_DEMOTE_ALLOTMENT);
+  run(0);
+  printf("quanta 2,4, boost every 10: hog ran %d,%d,%d ticks\n",
+         info[0].tickCounts[0], info[0].tickCounts[1], info[0].tickCounts[2]);
+  check(info[0].tickCounts[0] > 2, "boost didn't lift the hog to the top level");
+
+  setpolicy(2, 4, 0, MLFQ_DEMOTE_ALLOTMENT);   // the kernel's default
+  setScheduler(old);
+
+  printf(fail ? "mlfqtest: FAIL\n" : "mlfqtest: OK\n");
+  exit(fail);
+}
@@ -0,0 +1,203 @@
+// prof: sample the running system with the timer-driven profiler
+// and print a flat profile and a call graph.
+//
+// usage: prof -t ticks       profile everything for ticks ticks
+//        prof cmd arg...     profile while cmd runs
+//
+// Output lines are
+//   flat <count> <k|u>:<pc>
+//   arc <count> <k|u>:<caller> <k|u>:<callee>
+// most frequent first, where an arc's caller is a return address
+// and its callee a pc or return address in the function called.
+// Addresses are raw; profsym.pl, run on the host against
+// kernel/kernel.sym and user/_cmd.sym, turns them into function
+// names and totals per function.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define NFLAT 512
+#define NARC  1024
+#define NBUF  64
+
+struct flat {
+  uint64 pc;
+  int user;
+  int count;
+};
+
+struct arc {
+  uint64 from, to;
+  int user;
+  int count;
+};
+
+static struct flat flats[NFLAT];
+static struct arc arcs[NARC];
+static struct profsample buf[NBUF];
+static int nflat, narc, nsample, noverflow;
+static uint ndropped;
+
+static uint
+hash(uint64 a, uint64 b)
+{
+  return (uint)(a ^ (a >> 17) ^ (b * 31) ^ (b >> 13));
+}
+
+static void
+addflat(uint64 pc, int user)
+{
+  uint i, h;
+
+  h = hash(pc, user) % NFLAT;
+  for(i = 0; i < NFLAT; i++){
+    struct flat *f = &flats[(h + i) % NFLAT];
+    if(f->count == 0){
+      f->pc = pc;
+      f->user = user;
+      f->count = 1;
+      nflat++;
+      return;
+    }
+    if(f->pc == pc && f->user == user){
+      f->count++;
+      return;
+    }
+  }
+  noverflow++;
+}
+
+static void
+addarc(uint64 from, uint64 to, int user)
+{
+  uint i, h;
+
+  h = hash(from, to) % NARC;
+  for(i = 0; i < NARC; i++){
+    struct arc *a = &arcs[(h + i) % NARC];
+    if(a->count == 0){
+      a->from = from;
+      a->to = to;
+      a->user = user;
+      a->count = 1;
+      narc++;
+      return;
+    }
+    if(a->from == from && a->to == to && a->user == user){
+      a->count++;
+      return;
+    }
+  }
+  noverflow++;
+}
+
+// drain the kernel's sample rings; pid 0 means every process.
+static void
+drain(int pid)
+{
+  int n, i, j;
+  uint dropped;
+  struct profsample *s;
+
+  while((n = profread(buf, NBUF, &dropped)) > 0){
+    ndropped += dropped;
+    for(i = 0; i < n; i++){
+      s = &buf[i];
+      if(pid != 0 && s->pid != pid)
+        continue;
+      nsample++;
+      addflat(s->pc, s->user);
+      for(j = 0; j < s->depth; j++)
+        addarc(s->chain[j], j == 0 ? s->pc : s->chain[j-1], s->user);
+    }
+  }
+  if(n < 0){
+    fprintf(2, "prof: profread failed\n");
+    exit(1);
+  }
+  ndropped += dropped;
+}
+
+static char
+mode(int user)
+{
+  return user ? 'u' : 'k';
+}
+
+static void
+report(void)
+{
+  int i, j;
+  struct flat f;
+  struct arc a;
+
+  // insertion sort, most frequent first; empty slots sink to the end.
+  for(i = 1; i < NFLAT; i++){
+    f = flats[i];
+    for(j = i; j > 0 && flats[j-1].count < f.count; j--)
+      flats[j] = flats[j-1];
+    flats[j] = f;
+  }
+  for(i = 1; i < NARC; i++){
+    a = arcs[i];
+    for(j = i; j > 0 && arcs[j-1].count < a.count; j--)
+      arcs[j] = arcs[j-1];
+    arcs[j] = a;
+  }
+
+  printf("# %d samples, %d dropped", nsample, ndropped);
+  if(noverflow)
+    printf(", %d not tabulated", noverflow);
+  printf("\n");
+  for(i = 0; i < nflat; i++)
+    printf("flat %d %c:%p\n", flats[i].count, mode(flats[i].user), flats[i].pc);
+  for(i = 0; i < narc; i++)
+    printf("arc %d %c:%p %c:%p\n", arcs[i].count, mode(arcs[i].user),
+           arcs[i].from, mode(arcs[i].user), arcs[i].to);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid;
+
+  if(argc < 2){
+    fprintf(2, "usage: prof -t ticks | prof cmd arg...\n");
+    exit(1);
+  }
+
+  if(strcmp(argv[1], "-t") == 0){
+    if(argc != 3){
+      fprintf(2, "usage: prof -t ticks\n");
+      exit(1);
+    }
+    profctl(1);
+    sleep(atoi(argv[2]));
+    profctl(0);
+    drain(0);
+    report();
+    exit(0);
+  }
+
+  profctl(1);
+  pid = fork();
+  if(pid < 0){
+    profctl(0);
+    fprintf(2, "prof: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    exec(argv[1], argv + 1);
+    fprintf(2, "prof: exec %s failed\n", argv[1]);
+    exit(1);
+  }
+  // each hart buffers PROF_NSAMPLE ticks' worth of samples; longer
+  // runs keep the most recent ones and report the rest as dropped.
+  while(wait(0) != pid)
+    ;
+  profctl(0);
+  drain(pid);
+  report();
+  exit(0);
+}
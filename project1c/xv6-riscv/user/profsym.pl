@@ -0,0 +1,70 @@
+#!/usr/bin/perl -w
+
+# Symbolize the output of the xv6 prof program on the host.
+#
+# usage: perl user/profsym.pl kernel/kernel.sym [user/_cmd.sym] < prof.out
+#
+# Maps each k: and u: address to the function containing it, using
+# the .sym files the Makefile writes, then prints the flat profile
+# and the call graph summed per function.
+
+use strict;
+
+sub loadsyms {
+    my ($file) = @_;
+    my @syms;
+    open(my $fh, '<', $file) or die "$file: $!\n";
+    while (<$fh>) {
+        my ($addr, $name) = split;
+        next unless defined $name;
+        # skip section, file and local label symbols
+        next if $name =~ /^\./ || $name =~ /\.[cS]$/;
+        push @syms, [hex($addr), $name];
+    }
+    close($fh);
+    return [sort { $a->[0] <=> $b->[0] } @syms];
+}
+
+my $ksyms = loadsyms(shift @ARGV // die "usage: profsym.pl kernel.sym [user.sym]\n");
+my $usyms = @ARGV ? loadsyms(shift @ARGV) : undef;
+
+sub symbolize {
+    my ($tok) = @_;
+    my ($mode, $hex) = $tok =~ /^([ku]):(?:0x)?([0-9a-fA-F]+)$/ or return $tok;
+    my $syms = $mode eq 'k' ? $ksyms : $usyms;
+    return $tok unless $syms && @$syms;
+    my $addr = hex($hex);
+    my ($lo, $hi) = (0, scalar(@$syms) - 1);
+    return $tok if $addr < $syms->[0][0];
+    while ($lo < $hi) {
+        my $mid = int(($lo + $hi + 1) / 2);
+        if ($syms->[$mid][0] <= $addr) { $lo = $mid; } else { $hi = $mid - 1; }
+    }
+    return "$mode:$syms->[$lo][1]";
+}
+
+my (%flat, %arc);
+my $total = 0;
+while (<STDIN>) {
+    if (/^flat\s+(\d+)\s+(\S+)/) {
+        $flat{symbolize($2)} += $1;
+        $total += $1;
+    } elsif (/^arc\s+(\d+)\s+(\S+)\s+(\S+)/) {
+        my ($from, $to) = (symbolize($2), symbolize($3));
+        $arc{"$from -> $to"} += $1;
+    } elsif (/^#/) {
+        print;
+    }
+}
+
+print "\nflat profile:\n";
+printf("%8s %6s  %s\n", "samples", "%", "function");
+for my $f (sort { $flat{$b} <=> $flat{$a} || $a cmp $b } keys %flat) {
+    printf("%8d %6.2f  %s\n", $flat{$f}, $total ? 100 * $flat{$f} / $total : 0, $f);
+}
+
+print "\ncall graph:\n";
+printf("%8s  %s\n", "samples", "caller -> callee");
+for my $e (sort { $arc{$b} <=> $arc{$a} || $a cmp $b } keys %arc) {
+    printf("%8d  %s\n", $arc{$e}, $e);
+}
@@ -0,0 +1,74 @@
+// schedlat: print percentiles of the scheduling latency histograms
+// of the given processes.
+//
+// usage: schedlat pid...
+//
+// Each histogram bucket only bounds a time to a power of two, so a
+// percentile is reported as the upper bound of the bucket it falls
+// in.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define TIME_PER_US 10 // the time CSR runs at 10 MHz in qemu
+
+// Upper bound, in microseconds, of bucket i.
+static uint64
+bucket_us(int i)
+{
+  return ((uint64)2 << i) / TIME_PER_US;
+}
+
+static void
+report(char *what, uint *hist)
+{
+  static int pcts[] = {50, 90, 99};
+  uint64 total = 0, sum;
+  int i, j, max = 0;
+
+  for(i = 0; i < NLATBUCKET; i++){
+    total += hist[i];
+    if(hist[i])
+      max = i;
+  }
+  printf("  %s: n=%l", what, total);
+  if(total == 0){
+    printf("\n");
+    return;
+  }
+
+  sum = 0;
+  i = 0;
+  for(j = 0; j < sizeof(pcts) / sizeof(pcts[0]); j++){
+    while(i < NLATBUCKET && (sum + hist[i]) * 100 < total * pcts[j])
+      sum += hist[i++];
+    printf(" p%d<=%lus", pcts[j], bucket_us(i));
+  }
+  printf(" max<=%lus\n", bucket_us(max));
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct schedLatency lat;
+  int i, pid;
+
+  if(argc < 2){
+    fprintf(2, "usage: schedlat pid...\n");
+    exit(1);
+  }
+
+  for(i = 1; i < argc; i++){
+    pid = atoi(argv[i]);
+    if(getschedlatency(pid, &lat) < 0){
+      fprintf(2, "schedlat: no process %d\n", pid);
+      continue;
+    }
+    printf("pid %d (times in microseconds)\n", pid);
+    report("wait", lat.wait);
+    report("slice", lat.slice);
+    report("wakeup", lat.wakeup);
+  }
+  exit(0);
+}
@@ -0,0 +1,34 @@
+// slabstat: show the kernel's slab caches.
+//
+// usage: slabstat
+//
+// inuse is objects allocated and not yet freed; pages is what the
+// cache holds from kalloc(), including free objects waiting in
+// slabs and per-hart magazines. refill and flush count trips from
+// a magazine to the slabs, the only times the cache lock is taken.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/slab.h"
+#include "user/user.h"
+
+static struct slabstat stats[NSLABCACHE];
+
+int
+main(int argc, char *argv[])
+{
+  int n, i;
+  struct slabstat *s;
+
+  if((n = slabstat(stats, NSLABCACHE)) < 0){
+    fprintf(2, "slabstat: slabstat failed\n");
+    exit(1);
+  }
+  printf("name size perslab pages inuse alloc refill flush\n");
+  for(i = 0; i < n; i++){
+    s = &stats[i];
+    printf("%s %d %d %d %l %l %l %l\n", s->name, s->size, s->perslab,
+           s->slabs, s->alloc - s->free, s->alloc, s->refill, s->flush);
+  }
+  exit(0);
+}
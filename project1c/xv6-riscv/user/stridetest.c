@@ -0,0 +1,125 @@
+// stridetest: check that stride scheduling divides the cpu by tickets.
+//
+// usage: stridetest
+//
+// Starts CPU-bound children holding 100, 200 and 400 tickets and
+// lets them compete on one hart (CPUS=1, the default) for RUNTICKS
+// ticks, counting how many times each gets round its loop. Under
+// stride scheduling the counts should come out close to 1:2:4;
+// under round-robin, run the same way as a control, about even.
+// Also checks that setTickets() refuses counts out of range.
+// Leaves the scheduling class it found.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define RUNTICKS 60
+#define NCHILD   3
+
+static int tickets[NCHILD] = {100, 200, 400};
+static uint64 count[NCHILD];
+
+// Run a child per entry of tickets[] until RUNTICKS ticks from now,
+// and fill count[] with the loops each managed.
+static void
+run(void)
+{
+  int go[2], out[2], i, end;
+  struct {
+    int who;
+    uint64 n;
+  } msg;
+
+  if(pipe(go) < 0 || pipe(out) < 0){
+    fprintf(2, "stridetest: pipe failed\n");
+    exit(1);
+  }
+  for(i = 0; i < NCHILD; i++){
+    int pid = fork();
+    if(pid < 0){
+      fprintf(2, "stridetest: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      close(go[1]);
+      close(out[0]);
+      if(setTickets(tickets[i]) < 0 || read(go[0], &end, sizeof(end)) != sizeof(end))
+        exit(1);
+      msg.who = i;
+      msg.n = 0;
+      while(uptime() < end)
+        msg.n++;
+      write(out[1], &msg, sizeof(msg));
+      exit(0);
+    }
+  }
+  close(go[0]);
+  close(out[1]);
+  memset(count, 0, sizeof(count));
+  end = uptime() + RUNTICKS;
+  for(i = 0; i < NCHILD; i++)
+    write(go[1], &end, sizeof(end));
+  close(go[1]);
+  while(read(out[0], &msg, sizeof(msg)) == sizeof(msg))
+    count[msg.who] = msg.n;
+  close(out[0]);
+  for(i = 0; i < NCHILD; i++)
+    wait(0);
+}
+
+// Does count[i] stand to count[0] as want to 100, within 25%?
+static int
+near(int i, int want)
+{
+  uint64 got = count[i] * 100, exp = count[0] * want;
+
+  return got * 4 >= exp * 3 && got * 4 <= exp * 5;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int old, i, fail = 0;
+
+  // 1 to STRIDE_MAX_TICKETS (10000) are allowed.
+  if(setTickets(0) >= 0 || setTickets(10001) >= 0){
+    printf("stridetest: setTickets() took a count out of range\n");
+    fail = 1;
+  }
+
+  if((old = setScheduler(SCHED_STRIDE)) < 0){
+    fprintf(2, "stridetest: can't start stride scheduling\n");
+    exit(1);
+  }
+  run();
+  printf("stride:");
+  for(i = 0; i < NCHILD; i++)
+    printf(" %d tickets %l loops;", tickets[i], count[i]);
+  printf("\n");
+  for(i = 1; i < NCHILD; i++){
+    if(count[0] == 0 || !near(i, tickets[i])){
+      printf("stridetest: %d tickets didn't get %d times the cpu of %d\n",
+             tickets[i], tickets[i] / tickets[0], tickets[0]);
+      fail = 1;
+    }
+  }
+
+  setScheduler(SCHED_RR);
+  run();
+  printf("round-robin:");
+  for(i = 0; i < NCHILD; i++)
+    printf(" %d tickets %l loops;", tickets[i], count[i]);
+  printf("\n");
+  for(i = 1; i < NCHILD; i++){
+    if(count[0] == 0 || !near(i, 100)){
+      printf("stridetest: round-robin didn't share the cpu evenly\n");
+      fail = 1;
+      break;
+    }
+  }
+
+  setScheduler(old);
+  printf(fail ? "stridetest: FAIL\n" : "stridetest: OK\n");
+  exit(fail);
+}
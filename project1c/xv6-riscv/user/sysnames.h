@@ -0,0 +1,65 @@
+// Names of the system calls, indexed by number (kernel/syscall.h),
+// for tools that report on them.
+static char *sysnames[] = {
+  [SYS_fork]    "fork",
+  [SYS_exit]    "exit",
+  [SYS_wait]    "wait",
+  [SYS_pipe]    "pipe",
+  [SYS_read]    "read",
+  [SYS_kill]    "kill",
+  [SYS_exec]    "exec",
+  [SYS_fstat]   "fstat",
+  [SYS_chdir]   "chdir",
+  [SYS_dup]     "dup",
+  [SYS_getpid]  "getpid",
+  [SYS_sbrk]    "sbrk",
+  [SYS_sleep]   "sleep",
+  [SYS_uptime]  "uptime",
+  [SYS_open]    "open",
+  [SYS_write]   "write",
+  [SYS_mknod]   "mknod",
+  [SYS_unlink]  "unlink",
+  [SYS_link]    "link",
+  [SYS_mkdir]   "mkdir",
+  [SYS_close]   "close",
+  [SYS_getppid] "getppid",
+  [SYS_ps]      "ps",
+  [SYS_getschedhistory]   "getschedhistory",
+  [SYS_startMLFQ]         "startMLFQ",
+  [SYS_stopMLFQ]          "stopMLFQ",
+  [SYS_getMLFQInfo]       "getMLFQInfo",
+  [SYS_setMLFQPolicy]     "setMLFQPolicy",
+  [SYS_startStride]       "startStride",
+  [SYS_stopStride]        "stopStride",
+  [SYS_setTickets]        "setTickets",
+  [SYS_setScheduler]      "setScheduler",
+  [SYS_sched_setdeadline] "sched_setdeadline",
+  [SYS_setNice]           "setNice",
+  [SYS_getschedlatency]   "getschedlatency",
+  [SYS_profctl]           "profctl",
+  [SYS_profread]          "profread",
+  [SYS_tracectl]          "tracectl",
+  [SYS_traceread]         "traceread",
+  [SYS_getsysstat]        "getsysstat",
+  [SYS_lockstat]          "lockstat",
+  [SYS_getlockstat]       "getlockstat",
+  [SYS_lockbench]         "lockbench",
+  [SYS_futex_wait]        "futex_wait",
+  [SYS_futex_wake]        "futex_wake",
+  [SYS_clone]             "clone",
+  [SYS_join]              "join",
+  [SYS_sigalarm]          "sigalarm",
+  [SYS_sigreturn]         "sigreturn",
+  [SYS_kmemstat]          "kmemstat",
+  [SYS_slabstat]          "slabstat",
+  [SYS_buddystat]         "buddystat",
+  [SYS_buddytest]         "buddytest",
+};
+
+static char *
+sysname(int num)
+{
+  if(num <= 0 || num >= sizeof(sysnames)/sizeof(sysnames[0]) || sysnames[num] == 0)
+    return "?";
+  return sysnames[num];
+}
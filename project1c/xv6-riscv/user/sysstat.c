@@ -0,0 +1,98 @@
+// sysstat: show which system calls the kernel spends its time in.
+//
+// usage: sysstat             totals since boot
+//        sysstat cmd arg...  totals for the duration of cmd
+//
+// Calls are listed by total cycles, most first. Cycle counts are
+// per hart, so calls that returned on a different hart than they
+// started on are counted but not timed. exit never returns and so
+// never appears. Percentiles are upper bounds of log2 buckets.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/syscall.h"
+#include "user/user.h"
+#include "user/sysnames.h"
+
+static struct sysstat before[NSYSCALL], after[NSYSCALL];
+
+static void
+snapshot(struct sysstat *s)
+{
+  if(getsysstat(s) != NSYSCALL){
+    fprintf(2, "sysstat: getsysstat failed\n");
+    exit(1);
+  }
+}
+
+// upper bound, in cycles, of the bucket holding percentile pct.
+static uint64
+percentile(struct sysstat *s, int pct)
+{
+  uint64 total = 0, sum = 0;
+  int i;
+
+  for(i = 0; i < NLATBUCKET; i++)
+    total += s->hist[i];
+  if(total == 0)
+    return 0;
+  for(i = 0; i < NLATBUCKET - 1 && (sum + s->hist[i]) * 100 < total * pct; i++)
+    sum += s->hist[i];
+  return (uint64)2 << i;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int order[NSYSCALL];
+  int i, j, n, num, pid;
+  struct sysstat *s;
+  uint64 timed;
+
+  memset(before, 0, sizeof(before));
+  if(argc > 1){
+    snapshot(before);
+    pid = fork();
+    if(pid < 0){
+      fprintf(2, "sysstat: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      exec(argv[1], argv + 1);
+      fprintf(2, "sysstat: exec %s failed\n", argv[1]);
+      exit(1);
+    }
+    while(wait(0) != pid)
+      ;
+  }
+  snapshot(after);
+
+  n = 0;
+  for(num = 0; num < NSYSCALL; num++){
+    s = &after[num];
+    s->count -= before[num].count;
+    s->errors -= before[num].errors;
+    s->migrated -= before[num].migrated;
+    s->cycles -= before[num].cycles;
+    for(i = 0; i < NLATBUCKET; i++)
+      s->hist[i] -= before[num].hist[i];
+    if(s->count == 0)
+      continue;
+    // insertion sort by total cycles, most first
+    for(j = n; j > 0 && after[order[j-1]].cycles < s->cycles; j--)
+      order[j] = order[j-1];
+    order[j] = num;
+    n++;
+  }
+
+  printf("syscall calls errors migrated cycles avg p50<= p99<=\n");
+  for(i = 0; i < n; i++){
+    num = order[i];
+    s = &after[num];
+    timed = s->count - s->migrated;
+    printf("%s %l %l %l %l %l %l %l\n", sysname(num), s->count, s->errors,
+           s->migrated, s->cycles, timed ? s->cycles / timed : 0,
+           percentile(s, 50), percentile(s, 99));
+  }
+  exit(0);
+}
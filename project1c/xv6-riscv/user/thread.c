@@ -0,0 +1,78 @@
+// Threads on clone() and join().
+//
+// thread_create() gives each thread a malloc()ed stack and frees it
+// again in thread_join(). Stacks have no guard page, so a thread
+// that overflows its stack corrupts the heap.
+
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "user/user.h"
+
+#define TSTACK (4*4096)
+
+static struct {
+  int tid;
+  void *stack;
+} threads[NPROC];
+static struct mutex lock;
+
+// first function of every thread: the top of its stack holds the
+// function to run and its argument.
+static void
+thread_start(void *top)
+{
+  void (*fn)(void*) = ((void**)top)[0];
+  void *arg = ((void**)top)[1];
+
+  fn(arg);
+  exit(0);
+}
+
+// Run fn(arg) in a new thread. Returns its id, or -1.
+int
+thread_create(void (*fn)(void*), void *arg)
+{
+  char *stack;
+  void **top;
+  int i, tid;
+
+  if((stack = malloc(TSTACK)) == 0)
+    return -1;
+  top = (void**)(stack + TSTACK - 16);
+  top[0] = fn;
+  top[1] = arg;
+
+  mutex_lock(&lock);
+  for(i = 0; i < NPROC && threads[i].stack != 0; i++)
+    ;
+  if(i == NPROC || (tid = clone(thread_start, top, top)) < 0){
+    mutex_unlock(&lock);
+    free(stack);
+    return -1;
+  }
+  threads[i].tid = tid;
+  threads[i].stack = stack;
+  mutex_unlock(&lock);
+  return tid;
+}
+
+// Wait for thread tid to finish and free its stack.
+// Returns its exit status, or -1 if there is no such thread.
+int
+thread_join(int tid)
+{
+  int i, status;
+
+  if(tid <= 0 || join(tid, &status) < 0)
+    return -1;
+  mutex_lock(&lock);
+  for(i = 0; i < NPROC; i++){
+    if(threads[i].stack != 0 && threads[i].tid == tid){
+      free(threads[i].stack);
+      threads[i].stack = 0;
+      break;
+    }
+  }
+  mutex_unlock(&lock);
+  return status;
+}
@@ -0,0 +1,75 @@
+// threadbench: split a fixed CPU-bound job across 1 to NCPU
+// threads of one process and report how long each split takes.
+//
+// usage: threadbench [workload]
+//
+// The job is testsyscall's division loop, workload * 10^7
+// iterations in all. Threads report completion through a mutex and
+// condition variable. Run with enough harts (make CPUS=8 qemu) for
+// the speedup to show.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "user/user.h"
+
+static struct mutex lock;
+static struct cond alldone;
+static int ndone;
+static int chunk;  // iterations per thread, in units of 10^7
+
+static void
+work(void *arg)
+{
+  volatile double x = 987654321.9;
+  int t, i;
+
+  for(t = 0; t < chunk; t++)
+    for(i = 0; i < 10000000; i++)
+      x /= 12345.6789;
+
+  mutex_lock(&lock);
+  ndone++;
+  cond_signal(&alldone);
+  mutex_unlock(&lock);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int tids[NCPU];
+  int workload, n, i, start, elapsed, base = 0;
+
+  workload = argc > 1 ? atoi(argv[1]) : 8 * 7 * 5;
+  if(workload <= 0){
+    fprintf(2, "usage: threadbench [workload]\n");
+    exit(1);
+  }
+
+  printf("threads ticks speedup%%\n");
+  for(n = 1; n <= NCPU; n++){
+    chunk = workload / n;
+    ndone = 0;
+    start = uptime();
+    for(i = 0; i < n; i++){
+      if((tids[i] = thread_create(work, 0)) < 0){
+        fprintf(2, "threadbench: thread_create failed\n");
+        exit(1);
+      }
+    }
+
+    mutex_lock(&lock);
+    while(ndone < n)
+      cond_wait(&alldone, &lock);
+    mutex_unlock(&lock);
+    elapsed = uptime() - start;
+
+    for(i = 0; i < n; i++)
+      thread_join(tids[i]);
+
+    if(n == 1)
+      base = elapsed;
+    printf("%d %d %d\n", n, elapsed, elapsed ? base * 100 / elapsed : 0);
+  }
+  exit(0);
+}
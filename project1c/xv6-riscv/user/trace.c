@@ -0,0 +1,150 @@
+// trace: record kernel events and print them in time order.
+//
+// usage: trace -t ticks       trace everything for ticks ticks
+//        trace cmd arg...     trace while cmd runs
+//
+// Each line is: microseconds since the first event, hart, pid of
+// the process running on that hart, event, and its arguments.
+// Events from all harts are merged by timestamp. Each hart buffers
+// TRACE_NEVENT events; anything past that is counted as dropped.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "kernel/syscall.h"
+#include "kernel/trace.h"
+#include "user/user.h"
+#include "user/sysnames.h"
+
+#define MAXEVENT (NCPU * TRACE_NEVENT)
+#define TIME_PER_US 10 // the time CSR runs at 10 MHz in qemu
+
+static struct traceevent *events;
+static int nevent;
+static uint ndropped;
+
+static char *states[] = { "unused", "used", "sleeping", "runnable", "running", "zombie" };
+
+static void
+drain(void)
+{
+  int n;
+  uint dropped;
+
+  while(nevent < MAXEVENT &&
+        (n = traceread(events + nevent, MAXEVENT - nevent, &dropped)) > 0){
+    nevent += n;
+    ndropped += dropped;
+  }
+  // whatever didn't fit is thrown away by the next tracectl(1).
+}
+
+// shell sort by timestamp; each hart's events are already in order.
+static void
+sort(void)
+{
+  int gap, i, j;
+  struct traceevent e;
+
+  for(gap = nevent / 2; gap > 0; gap /= 2){
+    for(i = gap; i < nevent; i++){
+      e = events[i];
+      for(j = i; j >= gap && events[j-gap].time > e.time; j -= gap)
+        events[j] = events[j-gap];
+      events[j] = e;
+    }
+  }
+}
+
+static void
+print(struct traceevent *e, uint64 t0)
+{
+  uint64 us = (e->time - t0) / TIME_PER_US;
+
+  printf("%l %d %d ", us, e->hart, e->pid);
+  switch(e->type){
+  case TR_SCHED:
+    printf("sched %s\n", e->arg[0] < 6 ? states[e->arg[0]] : "?");
+    break;
+  case TR_SWTCH:
+    printf("swtch pid=%d queued=%lus\n", (int)e->arg[0], e->arg[1] / TIME_PER_US);
+    break;
+  case TR_SLEEP:
+    printf("sleep chan=%p%s\n", e->arg[0], e->arg[1] ? " exclusive" : "");
+    break;
+  case TR_WAKEUP:
+    printf("wakeup chan=%p pid=%d\n", e->arg[0], (int)e->arg[1]);
+    break;
+  case TR_SYSCALL:
+    printf("syscall %s(%p)\n", sysname(e->arg[0]), e->arg[1]);
+    break;
+  case TR_SYSRET:
+    printf("sysret %s = %d\n", sysname(e->arg[0]), (int)e->arg[1]);
+    break;
+  case TR_BREAD:
+    printf("bread %d%s\n", (int)e->arg[0], e->arg[1] ? " hit" : " miss");
+    break;
+  case TR_BWRITE:
+    printf("bwrite %d\n", (int)e->arg[0]);
+    break;
+  case TR_BEGIN_OP:
+    printf("begin_op outstanding=%d\n", (int)e->arg[0]);
+    break;
+  case TR_END_OP:
+    printf("end_op outstanding=%d%s\n", (int)e->arg[0], e->arg[1] ? " commit" : "");
+    break;
+  case TR_DISKINTR:
+    printf("diskintr done=%d\n", (int)e->arg[0]);
+    break;
+  default:
+    printf("type %d %p %p\n", e->type, e->arg[0], e->arg[1]);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid, i;
+
+  if(argc < 2){
+    fprintf(2, "usage: trace -t ticks | trace cmd arg...\n");
+    exit(1);
+  }
+  if((events = malloc(MAXEVENT * sizeof(*events))) == 0){
+    fprintf(2, "trace: out of memory\n");
+    exit(1);
+  }
+
+  if(strcmp(argv[1], "-t") == 0){
+    if(argc != 3){
+      fprintf(2, "usage: trace -t ticks\n");
+      exit(1);
+    }
+    tracectl(1);
+    sleep(atoi(argv[2]));
+    tracectl(0);
+  } else {
+    tracectl(1);
+    pid = fork();
+    if(pid < 0){
+      tracectl(0);
+      fprintf(2, "trace: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      exec(argv[1], argv + 1);
+      fprintf(2, "trace: exec %s failed\n", argv[1]);
+      exit(1);
+    }
+    while(wait(0) != pid)
+      ;
+    tracectl(0);
+  }
+
+  drain();
+  sort();
+  printf("# %d events, %d dropped\n", nevent, ndropped);
+  for(i = 0; i < nevent; i++)
+    print(&events[i], events[0].time);
+  exit(0);
+}
@@ -0,0 +1,84 @@
+// Mutexes and condition variables for threads sharing memory,
+// built on futex_wait() and futex_wake().
+//
+// An uncontended mutex_lock() or mutex_unlock() is one atomic
+// instruction and no system call; only a lock with waiters goes
+// to the kernel. The mutex follows Drepper's "Futexes Are Tricky".
+
+#include "kernel/types.h"
+#include "user/user.h"
+
+void
+mutex_init(struct mutex *m)
+{
+  m->state = 0;
+}
+
+void
+mutex_lock(struct mutex *m)
+{
+  uint c;
+
+  if((c = __sync_val_compare_and_swap(&m->state, 0, 1)) == 0)
+    return;
+  // contended: mark the lock as having waiters, then sleep until
+  // we are the one to take it from unlocked.
+  if(c != 2)
+    c = __sync_lock_test_and_set(&m->state, 2);
+  while(c != 0){
+    futex_wait(&m->state, 2);
+    c = __sync_lock_test_and_set(&m->state, 2);
+  }
+}
+
+// Take m if it is free. Returns 1 if it was taken, 0 if not.
+int
+mutex_trylock(struct mutex *m)
+{
+  return __sync_val_compare_and_swap(&m->state, 0, 1) == 0;
+}
+
+void
+mutex_unlock(struct mutex *m)
+{
+  if(__sync_fetch_and_sub(&m->state, 1) != 1){
+    // there may be waiters.
+    __sync_lock_release(&m->state);
+    futex_wake(&m->state, 1);
+  }
+}
+
+void
+cond_init(struct cond *c)
+{
+  c->seq = 0;
+}
+
+// Release m and wait for a signal, then take m again. As with any
+// condition variable, callers must recheck their condition.
+void
+cond_wait(struct cond *c, struct mutex *m)
+{
+  uint seq = c->seq;
+
+  mutex_unlock(m);
+  futex_wait(&c->seq, seq);
+  // others may be sleeping on m too, so take it in the "waiters"
+  // state to make sure our unlock wakes them.
+  while(__sync_lock_test_and_set(&m->state, 2) != 0)
+    futex_wait(&m->state, 2);
+}
+
+void
+cond_signal(struct cond *c)
+{
+  __sync_fetch_and_add(&c->seq, 1);
+  futex_wake(&c->seq, 1);
+}
+
+void
+cond_broadcast(struct cond *c)
+{
+  __sync_fetch_and_add(&c->seq, 1);
+  futex_wake(&c->seq, -1);
+}
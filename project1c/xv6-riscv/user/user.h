@@ -40,6 +40,33 @@ int atoi(const char *);
 int memcmp(const void *, const void *, uint);
 void *memcpy(void *, const void *, uint);
 
+// ulock.c
+struct mutex {
+    volatile uint state; // 0 unlocked, 1 locked, 2 locked with waiters
+};
+struct cond {
+    volatile uint seq;   // Bumped by every signal
+};
+void mutex_init(struct mutex *);
+void mutex_lock(struct mutex *);
+int mutex_trylock(struct mutex *);
+void mutex_unlock(struct mutex *);
+void cond_init(struct cond *);
+void cond_wait(struct cond *, struct mutex *);
+void cond_signal(struct cond *);
+void cond_broadcast(struct cond *);
+
+// thread.c
+int thread_create(void (*fn)(void *), void *arg);
+int thread_join(int tid);
+
+// uthread.c
+int uthread_create(void (*fn)(void *), void *arg);
+void uthread_yield(void);
+void uthread_exit(void);
+int uthread_self(void);
+void uthread_run(void);
+
 // Added system call declarations to specify
 //  the function interface for user programs
 int getppid(void);
@@ -62,6 +89,58 @@ struct sched_history
 };
 int getschedhistory(char *history);
 
+#define NLATBUCKET 32
+struct schedLatency {
+    uint wait[NLATBUCKET];   // Queued to run until running
+    uint slice[NLATBUCKET];  // Running until giving up the cpu
+    uint wakeup[NLATBUCKET]; // Woken from sleep until running
+};
+int getschedlatency(int pid, struct schedLatency *lat);
+
+#define PROF_DEPTH 8
+struct profsample {
+    uint64 pc;                // Interrupted pc
+    uint64 chain[PROF_DEPTH]; // Return addresses, innermost first
+    int depth;                // Valid entries in chain
+    int pid;                  // Interrupted process, 0 if none
+    int user;                 // Was pc a user address?
+    int hart;                 // Hart that took the sample
+};
+int profctl(int on);
+int profread(struct profsample *buf, int n, uint *dropped);
+
+struct traceevent; // kernel/trace.h
+int tracectl(int on);
+int traceread(struct traceevent *buf, int n, uint *dropped);
+
+#define NSYSCALL 64
+struct sysstat {
+    uint64 count;          // Calls that returned
+    uint64 errors;         // Calls that returned a negative value
+    uint64 migrated;       // Calls that returned on another hart, so untimed
+    uint64 cycles;         // Total cycles in timed calls
+    uint hist[NLATBUCKET]; // Log2 histogram of cycles per timed call
+};
+int getsysstat(struct sysstat *stats);
+
+struct lockstat; // kernel/lockstat.h
+int lockstat(int on);
+int getlockstat(struct lockstat *buf, int n);
+uint64 lockbench(int end);
+int futex_wait(volatile uint *addr, int val);
+int futex_wake(volatile uint *addr, int n);
+int clone(void (*fn)(void *), void *arg, void *stack);
+int join(int tid, int *status);
+int sigalarm(int ticks, void (*handler)(void));
+int sigreturn(void);
+struct kmemstat; // kernel/kmemstat.h
+int kmemstat(struct kmemstat *buf, int n);
+struct buddystat; // kernel/kmemstat.h
+int buddystat(struct buddystat *st);
+int buddytest(void);
+struct slabstat; // kernel/slab.h
+int slabstat(struct slabstat *buf, int n);
+
 
 
 // Define struct MLFQInfoReport
@@ -75,8 +154,29 @@ struct MLFQInfoReport {
     int tickCounts[MLFQ_MAX_LEVEL];     // Add tickCounts member
 };
 
+#define MLFQ_DEMOTE_ALLOTMENT 0 // ticks add up across sleeps until demotion
+#define MLFQ_DEMOTE_SLICE     1 // ticks start over each time it becomes runnable
+
+struct MLFQPolicy {
+    int quantum[MLFQ_MAX_LEVEL];        // Ticks a process may run at each level before demotion
+    int boostPeriod;                    // Ticks between boosts of every process to level 0, 0 for never
+    int demotion;                       // MLFQ_DEMOTE_ALLOTMENT or MLFQ_DEMOTE_SLICE
+};
+
 // Declare system call prototypes
 int startMLFQ(int m, int n);
 int stopMLFQ();
 int getMLFQInfo(struct MLFQInfoReport *report);
+int setMLFQPolicy(struct MLFQPolicy *policy);
+int startStride(void);
+int stopStride(void);
+int setTickets(int tickets);
+
+#define SCHED_RR     0
+#define SCHED_MLFQ   1
+#define SCHED_STRIDE 2
+#define SCHED_CFS    3
+int setScheduler(int policy);
+int sched_setdeadline(int runtime, int period, int deadline);
+int setNice(int nice);
 
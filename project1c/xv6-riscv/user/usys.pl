@@ -48,4 +48,30 @@ entry("getschedhistory");
 # would auto generate the assembly code
 entry("startMLFQ");
 entry("stopMLFQ");
-entry("getMLFQInfo");
\ No newline at end of file
+entry("getMLFQInfo");
+entry("setMLFQPolicy");
+entry("startStride");
+entry("stopStride");
+entry("setTickets");
+entry("setScheduler");
+entry("sched_setdeadline");
+entry("setNice");
+entry("getschedlatency");
+entry("profctl");
+entry("profread");
+entry("tracectl");
+entry("traceread");
+entry("getsysstat");
+entry("lockstat");
+entry("getlockstat");
+entry("lockbench");
+entry("futex_wait");
+entry("futex_wake");
+entry("clone");
+entry("join");
+entry("sigalarm");
+entry("sigreturn");
+entry("kmemstat");
+entry("slabstat");
+entry("buddystat");
+entry("buddytest");
\ No newline at end of file
@@ -0,0 +1,178 @@
+// User-level threads, scheduled cooperatively within one process.
+//
+// A thread runs until it calls uthread_yield() or uthread_exit(),
+// which switch straight to the next runnable thread in round-robin
+// order with uswtch(): no system call, and only the callee-saved
+// registers are saved. The caller of uthread_run() is thread 0.
+// Floating-point registers are not switched, so don't keep
+// floating-point values live across a yield.
+//
+// Stacks come from a pool: a thread's stack goes back to the pool
+// when it exits, and the pool only grows, in batches, with malloc().
+// Not for use from more than one clone() thread at a time.
+
+#include "kernel/types.h"
+#include "user/user.h"
+
+#define NUTHREAD 64
+#define USTACK   (2*4096)
+#define UBATCH   8           // stacks allocated at a time
+
+struct ucontext {
+  uint64 ra;
+  uint64 sp;
+  uint64 s[12];   // s0..s11
+};
+
+enum ustate { U_FREE, U_RUNNABLE, U_EXITED };
+
+struct uthread {
+  struct ucontext context;
+  enum ustate state;
+  char *stack;                // from the pool; 0 for thread 0
+  void (*fn)(void*);
+  void *arg;
+};
+
+void uswtch(struct ucontext*, struct ucontext*);
+
+static struct uthread threads[NUTHREAD];
+static struct uthread *current = &threads[0];
+static struct uthread *reap;  // exited; its stack is freed once we're off it
+
+// free stacks, linked through their first word.
+static char *stackpool;
+
+static char *
+stack_get(void)
+{
+  char *s, *batch;
+  int i;
+
+  if(stackpool == 0){
+    if((batch = malloc(UBATCH * USTACK)) == 0)
+      return 0;
+    for(i = 0; i < UBATCH; i++){
+      s = batch + i * USTACK;
+      *(char**)s = stackpool;
+      stackpool = s;
+    }
+  }
+  s = stackpool;
+  stackpool = *(char**)s;
+  return s;
+}
+
+static void
+stack_put(char *s)
+{
+  *(char**)s = stackpool;
+  stackpool = s;
+}
+
+// return the stack of a thread that exited and switched away.
+static void
+reap_exited(void)
+{
+  if(reap != 0){
+    stack_put(reap->stack);
+    reap->stack = 0;
+    reap->state = U_FREE;
+    reap = 0;
+  }
+}
+
+// the next runnable thread after current, or 0 if there is none.
+static struct uthread *
+next_runnable(void)
+{
+  struct uthread *t = current;
+
+  do {
+    if(++t == &threads[NUTHREAD])
+      t = threads;
+    if(t->state == U_RUNNABLE)
+      return t;
+  } while(t != current);
+  return 0;
+}
+
+// first function of every new thread.
+static void
+uthread_start(void)
+{
+  reap_exited();
+  current->fn(current->arg);
+  uthread_exit();
+}
+
+// Make a thread that will run fn(arg). Returns its id, or -1.
+int
+uthread_create(void (*fn)(void*), void *arg)
+{
+  struct uthread *t;
+
+  threads[0].state = U_RUNNABLE;
+  for(t = &threads[1]; t < &threads[NUTHREAD]; t++)
+    if(t->state == U_FREE)
+      break;
+  if(t == &threads[NUTHREAD] || (t->stack = stack_get()) == 0)
+    return -1;
+
+  memset(&t->context, 0, sizeof(t->context));
+  t->context.ra = (uint64)uthread_start;
+  t->context.sp = (uint64)(t->stack + USTACK);
+  t->fn = fn;
+  t->arg = arg;
+  t->state = U_RUNNABLE;
+  return t - threads;
+}
+
+// Let the next runnable thread run.
+void
+uthread_yield(void)
+{
+  struct uthread *t, *prev;
+
+  if((t = next_runnable()) == 0 || t == current)
+    return;
+  prev = current;
+  current = t;
+  uswtch(&prev->context, &t->context);
+  reap_exited();
+}
+
+// End the calling thread. Thread 0 may not exit this way.
+void
+uthread_exit(void)
+{
+  struct uthread *t, *prev;
+
+  if(current == &threads[0]){
+    fprintf(2, "uthread_exit: thread 0\n");
+    exit(1);
+  }
+  current->state = U_EXITED;
+  reap = current;
+  // thread 0 is runnable while any other thread is, so there is
+  // always somewhere to go.
+  t = next_runnable();
+  prev = current;
+  current = t;
+  uswtch(&prev->context, &t->context);
+}
+
+int
+uthread_self(void)
+{
+  return current - threads;
+}
+
+// Run the other threads until they have all exited.
+void
+uthread_run(void)
+{
+  threads[0].state = U_RUNNABLE;
+  while(next_runnable() != current)
+    uthread_yield();
+}
@@ -0,0 +1,82 @@
+// uthreadbench: compare a uthread context switch with a switch
+// between two processes ping-ponging a byte over pipes.
+//
+// usage: uthreadbench [rounds]
+//
+// Each round is two switches. Times are in ticks, so use enough
+// rounds for the pipe version to take several ticks.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+static int rounds;
+
+static void
+pingpong(void *arg)
+{
+  int i;
+
+  for(i = 0; i < rounds; i++)
+    uthread_yield();
+}
+
+static void
+report(char *what, int nswitch, int ticks)
+{
+  printf("%s: %d switches in %d ticks", what, nswitch, ticks);
+  if(ticks > 0)
+    printf(", %d per tick", nswitch / ticks);
+  printf("\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+  int start, i, pid, p2c[2], c2p[2];
+  char b = 0;
+
+  rounds = argc > 1 ? atoi(argv[1]) : 20000;
+  if(rounds <= 0){
+    fprintf(2, "usage: uthreadbench [rounds]\n");
+    exit(1);
+  }
+
+  // thread 0, in uthread_run(), and one other yielding to each other.
+  start = uptime();
+  if(uthread_create(pingpong, 0) < 0){
+    fprintf(2, "uthreadbench: uthread_create failed\n");
+    exit(1);
+  }
+  uthread_run();
+  report("uthread", 2 * rounds, uptime() - start);
+
+  // two processes passing a byte back and forth.
+  if(pipe(p2c) < 0 || pipe(c2p) < 0){
+    fprintf(2, "uthreadbench: pipe failed\n");
+    exit(1);
+  }
+  start = uptime();
+  if((pid = fork()) < 0){
+    fprintf(2, "uthreadbench: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    for(i = 0; i < rounds; i++){
+      if(read(p2c[0], &b, 1) != 1)
+        exit(1);
+      write(c2p[1], &b, 1);
+    }
+    exit(0);
+  }
+  for(i = 0; i < rounds; i++){
+    write(p2c[1], &b, 1);
+    if(read(c2p[0], &b, 1) != 1){
+      fprintf(2, "uthreadbench: pipe read failed\n");
+      exit(1);
+    }
+  }
+  wait(0);
+  report("fork+pipe", 2 * rounds, uptime() - start);
+  exit(0);
+}